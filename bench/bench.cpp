@@ -0,0 +1,191 @@
+#include "../src/game.hpp"
+#include "../src/jobsystem.hpp"
+#include "../src/profiler.hpp"
+#include "../src/random.hpp"
+
+// Scripted benchmark: builds a scaled scene, flies the camera along the path with a fixed timestep and reports
+// frame time percentiles, draw calls and per-scope CPU/GPU timings as JSON and CSV.
+//
+// Usage: OpenGL_bench [--asteroids N] [--tori N] [--point-lights N] [--spot-lights N] [--resolution WxH]
+//                     [--frames N] [--warmup N] [--out PREFIX] [--seed N] [--headless | --osmesa]
+//                     [--pipelined] [--merge-geometry] [--gpu-culling] [--no-clustered-lighting]
+//                     [--no-object-lights] [--no-bvh-culling] [--no-occlusion-culling] [--jobs N]
+//
+// bench/light_scaling.sh runs it over 16 to 4096 lights with each way of assigning lights.
+
+namespace {
+    struct Frame {
+        double time; // milliseconds
+        RenderQueue::Stats stats;
+        GLFrameStats gl; // zero unless built with GL_CALL_STATS
+    };
+
+    struct Percentiles {
+        double min, avg, p50, p95, p99, max;
+    };
+
+    Percentiles percentiles(std::vector<double> values) {
+        if (values.empty())
+            return {};
+
+        std::sort(values.begin(), values.end());
+        auto at = [&](double p) { return values[std::min(values.size() - 1, static_cast<size_t>(p * static_cast<double>(values.size())))]; };
+        double sum = std::accumulate(values.begin(), values.end(), 0.0);
+        return { values.front(), sum / static_cast<double>(values.size()), at(0.50), at(0.95), at(0.99), values.back() };
+    }
+
+    void writeJson(std::ostream& out, const Percentiles& p) {
+        out << "{\"min\":" << p.min << ",\"avg\":" << p.avg << ",\"p50\":" << p.p50 << ",\"p95\":" << p.p95
+            << ",\"p99\":" << p.p99 << ",\"max\":" << p.max << "}";
+    }
+}
+
+int main(int args, char** argv) {
+    uint64_t frames = 1000;
+    uint64_t warmup = 100;
+    uint32_t seed = 1;
+    uint32_t jobs = JobSystem::DefaultWorkerCount();
+    std::string out = "bench";
+
+    for (int i = 1; i < args; i++) {
+        std::string arg{ argv[i] };
+        if (arg == "--headless")
+            Game::backend = Window::Backend::Egl;
+        else if (arg == "--osmesa")
+            Game::backend = Window::Backend::OsMesa;
+        else if (arg == "--resolution" && i + 1 < args && std::sscanf(argv[i + 1], "%dx%d", &Game::resolution.x, &Game::resolution.y) == 2)
+            i++;
+    }
+
+    Game& game = Game::getInstance();
+    game.benchmark = true;
+
+    for (int i = 1; i < args; i++) {
+        std::string arg{ argv[i] };
+        if (arg == "--asteroids" && i + 1 < args)
+            game.asteroidCount = std::stoi(argv[++i]);
+        else if (arg == "--tori" && i + 1 < args)
+            game.torusCount = std::stoi(argv[++i]);
+        else if (arg == "--point-lights" && i + 1 < args)
+            game.pointLightCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+        else if (arg == "--spot-lights" && i + 1 < args)
+            game.spotLightCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+        else if (arg == "--frames" && i + 1 < args)
+            frames = std::stoull(argv[++i]);
+        else if (arg == "--warmup" && i + 1 < args)
+            warmup = std::stoull(argv[++i]);
+        else if (arg == "--out" && i + 1 < args)
+            out = argv[++i];
+        else if (arg == "--seed" && i + 1 < args)
+            seed = static_cast<uint32_t>(std::stoul(argv[++i]));
+        else if (arg == "--pipelined")
+            game.pipelined = true;
+        else if (arg == "--merge-geometry")
+            game.mergeGeometry = true;
+        else if (arg == "--gpu-culling")
+            game.gpuCulling = true;
+        else if (arg == "--no-clustered-lighting")
+            game.clusteredLighting = false;
+        else if (arg == "--no-object-lights")
+            game.objectLights = false;
+        else if (arg == "--no-bvh-culling")
+            game.bvhCulling = false;
+        else if (arg == "--no-occlusion-culling")
+            game.occlusionCulling = false;
+        else if (arg == "--jobs" && i + 1 < args)
+            jobs = static_cast<uint32_t>(std::stoul(argv[++i]));
+    }
+
+    Random::Seed(seed);
+    JobSystem::Init(jobs);
+
+    std::vector<Frame> recorded;
+    recorded.reserve(frames);
+
+    game.frameLimit = warmup + frames;
+    if (warmup == 0)
+        Profiler::BeginCapture();
+
+    game.onPresent = [&](double frameTime, const RenderQueue::Stats& stats) {
+        if (warmup != 0 && game.presentedFrames == warmup)
+            Profiler::BeginCapture();
+        else if (game.presentedFrames > warmup)
+            recorded.push_back({ frameTime * 1000.0, stats, GLStats::GetLastFrame() });
+    };
+
+    try {
+        game.init();
+        game.run();
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        JobSystem::Shutdown();
+        return EXIT_FAILURE;
+    }
+
+    JobSystem::Shutdown();
+
+    // Per scope durations over the measured frames
+    std::map<std::string, std::vector<double>> scopes;
+    for (const auto& event : Profiler::StopCapture())
+        scopes[(event.thread == Profiler::GpuThread ? "gpu:" : "cpu:") + std::string{ event.name }].push_back(static_cast<double>(event.duration) / 1000.0);
+
+    std::vector<double> times, draws, glCalls, glUploads;
+    for (const auto& frame : recorded) {
+        times.push_back(frame.time);
+        draws.push_back(static_cast<double>(frame.stats.drawCalls));
+        glCalls.push_back(static_cast<double>(frame.gl.calls));
+        glUploads.push_back(static_cast<double>(frame.gl.bufferBytes + frame.gl.textureBytes));
+    }
+
+    std::ofstream json{ out + ".json" };
+    json << "{\n\"scene\":{\"asteroids\":" << game.asteroidCount << ",\"tori\":" << game.torusCount
+         << ",\"point_lights\":" << game.pointLightCount << ",\"spot_lights\":" << game.spotLightCount
+         << ",\"resolution\":[" << Game::resolution.x << "," << Game::resolution.y << "],\"seed\":" << seed << "},\n";
+    json << "\"frames\":" << recorded.size() << ",\"warmup\":" << warmup << ",\"jobs\":" << jobs
+         << ",\"pipelined\":" << (game.pipelined ? "true" : "false")
+         << ",\"clustered_lighting\":" << (game.clusteredLighting ? "true" : "false")
+         << ",\"object_lights\":" << (game.objectLights ? "true" : "false")
+         << ",\"bvh_culling\":" << (game.bvhCulling ? "true" : "false")
+         << ",\"occlusion_culling\":" << (game.occlusionCulling ? "true" : "false") << ",\n";
+    json << "\"frame_ms\":";
+    writeJson(json, percentiles(times));
+    json << ",\n\"draw_calls\":";
+    writeJson(json, percentiles(draws));
+    if constexpr (GLStats::Enabled) {
+        json << ",\n\"gl_calls\":";
+        writeJson(json, percentiles(glCalls));
+        json << ",\n\"gl_upload_bytes\":";
+        writeJson(json, percentiles(glUploads));
+        json << ",\n\"gl_functions\":{";
+        bool first = true;
+        for (const auto& function : GLStats::GetFunctions()) {
+            json << (first ? "\n" : ",\n") << "\"" << function.name << "\":" << function.totalCalls;
+            first = false;
+        }
+        json << "\n}";
+    }
+    json << ",\n\"scopes_ms\":{";
+    bool first = true;
+    for (const auto& [name, durations] : scopes) {
+        json << (first ? "\n" : ",\n") << "\"" << name << "\":";
+        writeJson(json, percentiles(durations));
+        first = false;
+    }
+    json << "\n}\n}\n";
+
+    std::ofstream csv{ out + ".csv" };
+    csv << "frame,frame_ms,draw_calls,indirect_draws,packets,program_binds,vao_binds,texture_binds,"
+           "gl_calls,gl_draws,gl_program_binds,gl_vao_binds,gl_texture_binds,gl_uniforms,gl_buffer_bytes,gl_texture_bytes\n";
+    for (size_t i = 0; i < recorded.size(); i++) {
+        const auto& [time, stats, gl] = recorded[i];
+        csv << i << ',' << time << ',' << stats.drawCalls << ',' << stats.indirectDraws << ',' << stats.packets << ','
+            << stats.programBinds << ',' << stats.vaoBinds << ',' << stats.textureBinds << ','
+            << gl.calls << ',' << gl.drawCalls << ',' << gl.programBinds << ',' << gl.vaoBinds << ',' << gl.textureBinds << ','
+            << gl.uniformUploads << ',' << gl.bufferBytes << ',' << gl.textureBytes << '\n';
+    }
+
+    auto summary = percentiles(times);
+    std::cout << "frame ms p50 " << summary.p50 << ", p95 " << summary.p95 << ", p99 " << summary.p99
+              << " over " << recorded.size() << " frames, written to " << out << ".json/.csv" << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,110 @@
+#include "../src/components.hpp"
+#include "../src/cullingsystem.hpp"
+#include "../src/bvh.hpp"
+#include "../src/jobsystem.hpp"
+#include "timing.hpp"
+
+// Frustum culling of 10k, 100k and 1M bounding spheres: the per object Frustum::checkSphere loop the snapshot used
+// against CullingSystem with every instruction set the CPU has, inline (0 workers) and on all hardware threads,
+// and against traversing a Bvh over the same spheres.
+// Usage: culling_bench [repeats]
+
+namespace {
+    struct Object {
+        TransformComponent transform;
+        float radius;
+    };
+
+    // Distance of the sphere's surface to the nearest plane, the SIMD paths may round differently right at zero
+    float margin(const Frustum& frustum, const glm::vec4& sphere) {
+        float nearest = std::numeric_limits<float>::max();
+        for (const auto& plane : frustum.planes)
+            nearest = std::min(nearest, std::abs(glm::dot(glm::vec3{ plane }, glm::vec3{ sphere }) + plane.w + sphere.w));
+        return nearest;
+    }
+
+    bool matches(const Frustum& frustum, const CullingSystem& culling, const std::vector<uint32_t>& expected, const std::vector<uint32_t>& visible) {
+        std::vector<uint32_t> differ;
+        std::set_symmetric_difference(expected.begin(), expected.end(), visible.begin(), visible.end(), std::back_inserter(differ));
+        return std::all_of(differ.begin(), differ.end(), [&](uint32_t i) { return margin(frustum, culling.getSphere(i)) < 1e-3f; });
+    }
+}
+
+int main(int args, char** argv) {
+    int repeats = args > 1 ? std::stoi(argv[1]) : 5;
+    uint32_t threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    // Objects fill a cube around the camera, about a tenth of them end up on screen
+    Frustum frustum;
+    frustum.update(glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 2000.0f) * glm::lookAt(glm::vec3{ 0.0f }, glm::vec3{ 0.0f, 0.0f, -1.0f }, glm::vec3{ 0.0f, 1.0f, 0.0f }));
+
+    std::cout << "supported " << CullingSystem::GetName(CullingSystem::GetSupportedIsa()) << ", hardware threads " << threads << '\n';
+    std::cout << "objects  path  workers  time(ms)  speedup\n";
+
+    for (uint32_t count : { 10000u, 100000u, 1000000u }) {
+        std::mt19937 random{ count };
+        std::uniform_real_distribution<float> position{ -1000.0f, 1000.0f };
+        std::uniform_real_distribution<float> scale{ 0.5f, 4.0f };
+
+        std::vector<Object> objects(count);
+        CullingSystem culling;
+        culling.resize(count);
+        for (uint32_t i = 0; i < count; i++) {
+            auto& [transform, radius] = objects[i];
+            transform.translation = { position(random), position(random), position(random) };
+            transform.scale = glm::vec3{ scale(random), scale(random), scale(random) };
+            radius = scale(random);
+            culling.set(i, transform.translation, radius * glm::max(transform.scale.x, transform.scale.y, transform.scale.z));
+        }
+
+        std::vector<uint32_t> expected;
+        double reference = measure(repeats, [&] {
+            expected.clear();
+            for (uint32_t i = 0; i < count; i++) {
+                const auto& [transform, radius] = objects[i];
+                if (frustum.checkSphere(transform.translation, radius * glm::max(transform.scale.x, transform.scale.y, transform.scale.z)))
+                    expected.push_back(i);
+            }
+        });
+        std::cout << count << "  checkSphere  0  " << reference << "  1.00  (" << expected.size() << " visible)\n";
+
+        for (uint32_t workers : { 0u, threads }) {
+            JobSystem::Init(workers);
+            for (auto isa : { CullingSystem::Isa::Scalar, CullingSystem::Isa::SSE, CullingSystem::Isa::AVX2, CullingSystem::Isa::AVX512 }) {
+                if (isa > CullingSystem::GetSupportedIsa())
+                    continue;
+
+                culling.setIsa(isa);
+                std::vector<uint32_t> visible;
+                double time = measure(repeats, [&] { culling.cull(frustum, visible); });
+
+                if (!matches(frustum, culling, expected, visible)) {
+                    std::cerr << "ERROR: " << CullingSystem::GetName(isa) << " culling of " << count << " objects differs from checkSphere" << std::endl;
+                    JobSystem::Shutdown();
+                    return EXIT_FAILURE;
+                }
+                std::cout << count << "  " << CullingSystem::GetName(isa) << "  " << workers << "  " << time << "  " << reference / time << '\n';
+            }
+            JobSystem::Shutdown();
+        }
+
+        Bvh bvh;
+        std::vector<glm::vec4> spheres(count);
+        for (uint32_t i = 0; i < count; i++)
+            spheres[i] = culling.getSphere(i);
+        double build = measure(1, [&] { bvh.build(spheres); });
+
+        std::vector<uint32_t> visible;
+        double time = measure(repeats, [&] {
+            visible.clear();
+            bvh.cull(frustum, visible);
+        });
+        std::sort(visible.begin(), visible.end());
+        if (!matches(frustum, culling, expected, visible)) {
+            std::cerr << "ERROR: BVH culling of " << count << " objects differs from checkSphere" << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::cout << count << "  BVH  0  " << time << "  " << reference / time << "  (" << bvh.getNodeCount() << " nodes built in " << build << " ms)\n";
+    }
+    return EXIT_SUCCESS;
+}
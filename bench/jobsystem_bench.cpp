@@ -0,0 +1,57 @@
+#include "../src/jobsystem.hpp"
+
+// Scaling benchmark for the job system: the same CPU bound workload is run with 0 (inline), 1, 2, 4, ... 32 workers.
+// Usage: jobsystem_bench [elements] [grain] [repeats]
+
+namespace {
+    float work(uint32_t i) {
+        float x = static_cast<float>(i) * 0.001f;
+        for (int k = 0; k < 256; k++)
+            x = std::sin(x) * 0.5f + std::cos(x * 1.3f);
+        return x;
+    }
+
+    double measure(std::vector<float>& out, uint32_t grain, int repeats) {
+        double best = 1e30;
+        for (int r = 0; r < repeats; r++) {
+            auto start = std::chrono::steady_clock::now();
+            JobSystem::ParallelFor(0, static_cast<uint32_t>(out.size()), grain, [&](uint32_t first, uint32_t last) {
+                for (uint32_t i = first; i < last; i++)
+                    out[i] = work(i);
+            });
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min(best, elapsed.count());
+        }
+        return best;
+    }
+}
+
+int main(int args, char** argv) {
+    uint32_t elements = args > 1 ? static_cast<uint32_t>(std::stoul(argv[1])) : 1 << 18;
+    uint32_t grain = args > 2 ? static_cast<uint32_t>(std::stoul(argv[2])) : 256;
+    int repeats = args > 3 ? std::stoi(argv[3]) : 5;
+
+    std::vector<float> reference(elements);
+    std::vector<float> out(elements);
+
+    JobSystem::Init(0);
+    double inline_ = measure(reference, grain, repeats);
+    JobSystem::Shutdown();
+
+    std::cout << "elements " << elements << ", grain " << grain << ", hardware threads " << std::thread::hardware_concurrency() << '\n';
+    std::cout << "workers  time(ms)  speedup\n";
+    std::cout << "inline   " << inline_ << "  1.00\n";
+
+    for (uint32_t workers : { 1u, 2u, 4u, 8u, 16u, 32u }) {
+        JobSystem::Init(workers);
+        double time = measure(out, grain, repeats);
+        JobSystem::Shutdown();
+
+        if (out != reference) {
+            std::cerr << "ERROR: results with " << workers << " workers differ from the inline run" << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::cout << workers << "        " << time << "  " << inline_ / time << '\n';
+    }
+    return EXIT_SUCCESS;
+}
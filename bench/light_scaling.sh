@@ -0,0 +1,27 @@
+#!/usr/bin/env bash
+# Frame time over 16 to 4096 point lights for each way of assigning lights: per object (default), per view frustum
+# cluster, and every light for every fragment.
+# Usage: bench/light_scaling.sh path/to/OpenGL_bench [bench options...]
+# Writes one bench run per configuration and a summary to light_scaling.csv.
+set -euo pipefail
+
+bench=${1:?usage: $0 path/to/OpenGL_bench [bench options...]}
+shift
+
+echo "lights,assignment,p50_ms,p95_ms,p99_ms" > light_scaling.csv
+for lights in 16 64 256 1024 4096; do
+    for assignment in objects clusters all; do
+        out="light_scaling_${lights}_${assignment}"
+        flags=()
+        case "$assignment" in
+            clusters) flags=(--no-object-lights) ;;
+            all) flags=(--no-object-lights --no-clustered-lighting) ;;
+        esac
+
+        "$bench" --point-lights "$lights" --out "$out" "${flags[@]}" "$@"
+        percentiles=$(sed -n 's/.*"frame_ms":{[^}]*"p50":\([^,]*\),"p95":\([^,]*\),"p99":\([^,]*\),.*/\1,\2,\3/p' "$out.json")
+        echo "$lights,$assignment,$percentiles" >> light_scaling.csv
+    done
+done
+
+column -s, -t light_scaling.csv
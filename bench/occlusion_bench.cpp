@@ -0,0 +1,79 @@
+#include "../src/occlusionculler.hpp"
+#include "../src/jobsystem.hpp"
+#include "timing.hpp"
+
+// Software occlusion culling without a window: a wall of sphere occluders in front of the camera hides a field of
+// objects behind it. Checks that objects in front of the wall and beside it stay visible and that the ones straight
+// behind it are culled, then times rasterizing the occluders and testing 10k, 100k and 1M spheres.
+// Usage: occlusion_bench [repeats] [workers]
+
+int main(int args, char** argv) {
+    int repeats = args > 1 ? std::stoi(argv[1]) : 5;
+    uint32_t workers = args > 2 ? static_cast<uint32_t>(std::stoul(argv[2])) : std::thread::hardware_concurrency();
+
+    JobSystem::Init(workers);
+
+    // Camera at the origin looking down -z, the wall is a grid of overlapping spheres 100 units away
+    glm::mat4 viewProjection = glm::perspective(glm::radians(60.0f), 2.0f, 0.1f, 2000.0f) * glm::lookAt(glm::vec3{ 0.0f }, glm::vec3{ 0.0f, 0.0f, -1.0f }, glm::vec3{ 0.0f, 1.0f, 0.0f });
+    auto occluder = OcclusionCuller::Sphere(12.0f);
+
+    OcclusionCuller culler;
+    auto rasterize = [&] {
+        culler.begin(viewProjection);
+        for (int y = -4; y <= 4; y++) {
+            for (int x = -8; x <= 8; x++)
+                culler.add(*occluder, glm::translate(glm::mat4{ 1.0f }, glm::vec3{ x * 15.0f, y * 15.0f, -100.0f }));
+        }
+        culler.rasterize();
+    };
+
+    double raster = measure(repeats, rasterize);
+    std::cout << "workers " << workers << ", " << culler.getPartCount() << " occluder parts rasterized in " << raster << " ms\n";
+
+    struct Case {
+        glm::vec3 center;
+        float radius;
+        bool visible;
+    };
+    const Case cases[] = {
+        { { 0.0f, 0.0f, -300.0f }, 10.0f, false }, // behind the middle of the wall
+        { { 40.0f, -20.0f, -500.0f }, 20.0f, false },
+        { { 0.0f, 0.0f, -50.0f }, 5.0f, true }, // in front of it
+        { { 0.0f, 0.0f, -300.0f }, 250.0f, true }, // reaching in front of it
+        { { 600.0f, 0.0f, -300.0f }, 10.0f, true }, // beside it
+        { { 0.0f, 0.0f, 0.0f }, 1.0f, true }, // around the camera
+    };
+    for (const auto& test : cases) {
+        if (culler.isVisible(test.center, test.radius) != test.visible) {
+            std::cerr << "ERROR: sphere at " << glm::to_string(test.center) << " with radius " << test.radius << " should be " << (test.visible ? "visible" : "occluded") << std::endl;
+            JobSystem::Shutdown();
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::cout << "objects  time(ms)  ns/object  occluded\n";
+    for (uint32_t count : { 10000u, 100000u, 1000000u }) {
+        std::mt19937 random{ count };
+        std::uniform_real_distribution<float> across{ -400.0f, 400.0f };
+        std::uniform_real_distribution<float> depth{ -1000.0f, -20.0f };
+        std::uniform_real_distribution<float> size{ 0.5f, 8.0f };
+
+        std::vector<glm::vec4> spheres(count);
+        for (auto& sphere : spheres)
+            sphere = { across(random), across(random) * 0.5f, depth(random), size(random) };
+
+        std::vector<uint8_t> visible(count);
+        double time = measure(repeats, [&] {
+            JobSystem::ParallelFor(0, count, 1024, [&](uint32_t first, uint32_t last) {
+                for (uint32_t i = first; i < last; i++)
+                    visible[i] = culler.isVisible(glm::vec3{ spheres[i] }, spheres[i].w);
+            });
+        });
+
+        auto occluded = count - std::accumulate(visible.begin(), visible.end(), 0u);
+        std::cout << count << "  " << time << "  " << time * 1e6 / count << "  " << occluded << '\n';
+    }
+
+    JobSystem::Shutdown();
+    return EXIT_SUCCESS;
+}
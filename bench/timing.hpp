@@ -0,0 +1,14 @@
+#pragma once
+
+// Best of repeated runs in milliseconds, the fastest run is the one least disturbed by the rest of the system
+template <typename Function>
+double measure(int repeats, Function&& function) {
+    double best = 1e30;
+    for (int r = 0; r < repeats; r++) {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
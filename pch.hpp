@@ -5,9 +5,14 @@
 #include <iostream>
 #include <sstream>
 #include <algorithm>
+#include <numeric>
 #include <functional>
 #include <memory>
 #include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
 #include <utility>
 #include <cstdlib>
 #include <cstddef>
@@ -27,6 +32,7 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <optional>
+#include <limits>
 
 // OPENGL/VULKAN
 #include <glad/glad.h>
@@ -1,5 +1,11 @@
 #version 430 core
 
+// Variants are selected by the defines Shader::define injects below the version line:
+// HAS_TEXTURE, LIGHTING, FOG, COLOURING, CLUSTERED and OBJECT_LIGHTS, plus FOG_FACTOR_TYPE 0 (linear), 1 (exp) or 2 (exp2)
+#ifndef FOG_FACTOR_TYPE
+#define FOG_FACTOR_TYPE 0
+#endif
+
 layout(location = 0) out vec4 o_color;
 
 struct Material {
@@ -10,12 +16,10 @@ struct Material {
 	float transparency;
 };
 
-const int MAX_POINT_LIGHTS = 16;
-const int MAX_SPOT_LIGHTS = 16;
-
 in vec2 v_tex_coord;
 in vec3 v_normal;
 in vec3 v_position;
+in float v_transparency;
 
 struct VSOutput {
 	vec2 TexCoord;
@@ -23,87 +27,101 @@ struct VSOutput {
 	vec3 WorldPos;
 };
 
-struct BaseLight {
+// Must match GpuDirectionalLight/GpuLight in lights.hpp
+struct DirectionalLight {
 	vec3 Color;
 	float AmbientIntensity;
+	vec3 Direction;
 	float DiffuseIntensity;
 };
 
-struct DirectionalLight {
-	BaseLight Base;
+// Point lights ignore Direction and Cutoff
+struct Light {
+	vec3 Color;
+	float AmbientIntensity;
+	vec3 Position;
+	float DiffuseIntensity;
+	vec3 Atten; // constant, linear, exp
+	float Cutoff;
 	vec3 Direction;
+	float Range; // only used to sort lights into clusters
 };
 
-struct Attenuation {
-	float Constant;
-	float Linear;
-	float Exp;
+// Must match LightBuffer::Binding, point lights come first and spot lights follow
+layout(std430, binding = 8) readonly buffer LightBlock {
+	DirectionalLight gDirectionalLight;
+	uint gNumPointLights;
+	uint gNumSpotLights;
+	Light gLights[];
 };
 
-struct PointLight {
-	BaseLight Base;
-	vec3 Position;
-	Attenuation Atten;
+#ifdef CLUSTERED
+// Must match LightClusters, the view frustum split into tiles and exponential depth slices
+layout(std430, binding = 9) readonly buffer ClusterBlock {
+	vec2 gTileSize; // in pixels
+	float gSliceScale;
+	float gSliceBias;
+	uvec4 gClusterCount;
+	uvec2 gClusters[]; // first entry in gClusterLights, light count
 };
 
-struct SpotLight {
-	PointLight Base;
-	vec3 Direction;
-	float Cutoff;
+layout(std430, binding = 10) readonly buffer ClusterLightBlock {
+	uint gClusterLights[]; // indices into gLights
+};
+#endif
+
+#ifdef OBJECT_LIGHTS
+// The lights reaching this object, a range of the list LightBuffer::bindObjectLights uploads
+flat in uvec2 v_lights; // first entry in gObjectLights, light count
+
+layout(std430, binding = 11) readonly buffer ObjectLightBlock {
+	uint gObjectLights[]; // indices into gLights
 };
+#endif
 
-uniform int gNumPointLights = 0;
-uniform int gNumSpotLights = 0;
-uniform DirectionalLight gDirectionalLight;
-uniform PointLight gPointLights[MAX_POINT_LIGHTS];
-uniform SpotLight gSpotLights[MAX_SPOT_LIGHTS];
 uniform sampler2D diffuse0;
 uniform vec3 gEyeWorldPos;
 uniform float gMatSpecularIntensity;
 uniform float gSpecularPower;
-uniform bool has_texture = false;
 uniform Material material;
-uniform float transparency = 1.0f;
-uniform bool lighting_on = true;
-uniform bool fog_on = false;
 uniform vec3 fog_colour;
-uniform int fog_factor_type;
 uniform float fog_start = 3.0f;
 uniform float fog_end = 15.0f;
 
 in vec4 v_pos;
 float rho = 0.15f;
 
-uniform bool colouring_on = false;
 uniform vec3 in_colour = vec3(1,1,1);
 uniform vec2 texture_scale = vec2(1,1);
 
-vec4 CalcLightInternal(BaseLight Light, vec3 LightDirection, VSOutput In)
+vec4 CalcLightInternal(vec3 Color, float AmbientIntensity, float DiffuseIntensity, vec3 LightDirection, VSOutput In)
 {
-	vec4 AmbientColor;
-	if (has_texture)
-		AmbientColor = vec4(Light.Color * Light.AmbientIntensity, 1.0f);
-	else
-		AmbientColor = vec4(Light.Color * Light.AmbientIntensity * material.ambient, 1.0f);
+#ifdef HAS_TEXTURE
+	vec4 AmbientColor = vec4(Color * AmbientIntensity, 1.0f);
+#else
+	vec4 AmbientColor = vec4(Color * AmbientIntensity * material.ambient, 1.0f);
+#endif
 	float DiffuseFactor = dot(In.Normal, -LightDirection);
 
 	vec4 DiffuseColor  = vec4(0, 0, 0, 0);
 	vec4 SpecularColor = vec4(0, 0, 0, 0);
 
 	if (DiffuseFactor > 0.0) {
-		if (has_texture)
-			DiffuseColor = vec4(Light.Color * Light.DiffuseIntensity * DiffuseFactor, 1.0f);
-		else
-			DiffuseColor = vec4(Light.Color * Light.DiffuseIntensity * DiffuseFactor * material.diffuse, 1.0f);
+#ifdef HAS_TEXTURE
+		DiffuseColor = vec4(Color * DiffuseIntensity * DiffuseFactor, 1.0f);
+#else
+		DiffuseColor = vec4(Color * DiffuseIntensity * DiffuseFactor * material.diffuse, 1.0f);
+#endif
 		vec3 VertexToEye = normalize(gEyeWorldPos - In.WorldPos);
 		vec3 LightReflect = normalize(reflect(LightDirection, In.Normal));
 		float SpecularFactor = dot(VertexToEye, LightReflect);
 		if (SpecularFactor > 0.0) {
 			SpecularFactor = pow(SpecularFactor, gSpecularPower);
-			if (has_texture)
-				SpecularColor = vec4(Light.Color * gMatSpecularIntensity * SpecularFactor, 1.0f);
-			else
-				SpecularColor = vec4(Light.Color * gMatSpecularIntensity * SpecularFactor * material.specular * material.shininess, 1.0f);
+#ifdef HAS_TEXTURE
+			SpecularColor = vec4(Color * gMatSpecularIntensity * SpecularFactor, 1.0f);
+#else
+			SpecularColor = vec4(Color * gMatSpecularIntensity * SpecularFactor * material.specular * material.shininess, 1.0f);
+#endif
 		}
 	}
 
@@ -112,36 +130,41 @@ vec4 CalcLightInternal(BaseLight Light, vec3 LightDirection, VSOutput In)
 
 vec4 CalcDirectionalLight(VSOutput In)
 {
-	return CalcLightInternal(gDirectionalLight.Base, gDirectionalLight.Direction, In);
+	return CalcLightInternal(gDirectionalLight.Color, gDirectionalLight.AmbientIntensity, gDirectionalLight.DiffuseIntensity, gDirectionalLight.Direction, In);
 }
 
-vec4 CalcPointLight(PointLight l, VSOutput In)
+vec4 CalcPointLight(Light l, VSOutput In)
 {
 	vec3 LightDirection = In.WorldPos - l.Position;
 	float Distance = length(LightDirection);
 	LightDirection = normalize(LightDirection);
 
-	vec4 Color = CalcLightInternal(l.Base, LightDirection, In);
-	float Attenuation =  l.Atten.Constant +
-	l.Atten.Linear * Distance +
-	l.Atten.Exp * Distance * Distance;
+	vec4 Color = CalcLightInternal(l.Color, l.AmbientIntensity, l.DiffuseIntensity, LightDirection, In);
+	float Attenuation =  l.Atten.x +
+	l.Atten.y * Distance +
+	l.Atten.z * Distance * Distance;
 
 	return Color / Attenuation;
 }
 
-vec4 CalcSpotLight(SpotLight l, VSOutput In)
+vec4 CalcSpotLight(Light l, VSOutput In)
 {
-	vec3 LightToPixel = normalize(In.WorldPos - l.Base.Position);
+	vec3 LightToPixel = normalize(In.WorldPos - l.Position);
 	float SpotFactor = dot(LightToPixel, l.Direction);
 
 	if (SpotFactor > l.Cutoff) {
-		vec4 Color = CalcPointLight(l.Base, In);
+		vec4 Color = CalcPointLight(l, In);
 		return Color * (1.0 - (1.0 - SpotFactor) * 1.0 / (1.0 - l.Cutoff));
 	} else {
 		return vec4(0,0,0,0);
 	}
 }
 
+vec4 CalcLight(uint index, VSOutput In)
+{
+	return index < gNumPointLights ? CalcPointLight(gLights[index], In) : CalcSpotLight(gLights[index], In);
+}
+
 void main()
 {
 	VSOutput In;
@@ -151,55 +174,71 @@ void main()
 
 	vec4 result;
 
-	if (!lighting_on) {
-		if (has_texture) {
-			result = texture(diffuse0, In.TexCoord.xy);
-			result.w = transparency;
-		} else
-			result = vec4(material.ambient, material.transparency);
-
-		// uncomment the following to affect the skybox with the light colour
-		//result = light.colour * texture(diffuse0, In.TexCoord.xy);
-	} else  {
+#ifndef LIGHTING
+#ifdef HAS_TEXTURE
+	result = texture(diffuse0, In.TexCoord.xy);
+	result.w = v_transparency;
+#else
+	result = vec4(material.ambient, material.transparency);
+#endif
+
+	// uncomment the following to affect the skybox with the light colour
+	//result = light.colour * texture(diffuse0, In.TexCoord.xy);
+#else
+	{
 		vec4 TotalLight = CalcDirectionalLight(In);
 
-		for (int i = 0 ; i < gNumPointLights ; i++) {
-			TotalLight += CalcPointLight(gPointLights[i], In);
+#if defined(OBJECT_LIGHTS)
+		for (uint i = v_lights.x ; i < v_lights.x + v_lights.y ; i++) {
+			TotalLight += CalcLight(gObjectLights[i], In);
 		}
-
-		for (int i = 0 ; i < gNumSpotLights ; i++) {
-			TotalLight += CalcSpotLight(gSpotLights[i], In);
+#elif defined(CLUSTERED)
+		// v_pos is in clip space, its w is the view depth
+		uvec3 cluster = uvec3(uvec2(gl_FragCoord.xy / gTileSize), uint(max(log(v_pos.w) * gSliceScale + gSliceBias, 0.0)));
+		cluster = min(cluster, gClusterCount.xyz - 1u);
+		uvec2 range = gClusters[(cluster.z * gClusterCount.y + cluster.y) * gClusterCount.x + cluster.x];
+
+		for (uint i = range.x ; i < range.x + range.y ; i++) {
+			TotalLight += CalcLight(gClusterLights[i], In);
+		}
+#else
+		for (uint i = 0 ; i < gNumPointLights ; i++) {
+			TotalLight += CalcPointLight(gLights[i], In);
 		}
 
-		if (has_texture) {
-			result = texture(diffuse0, In.TexCoord.xy) * TotalLight;
-			result.w = transparency;
-		} else {
-			if (material.transparency < 1.0)
-				TotalLight.w = material.transparency;
-			result = TotalLight;
+		for (uint i = 0 ; i < gNumSpotLights ; i++) {
+			TotalLight += CalcSpotLight(gLights[gNumPointLights + i], In);
 		}
+#endif
+
+#ifdef HAS_TEXTURE
+		result = texture(diffuse0, In.TexCoord.xy) * TotalLight;
+		result.w = v_transparency;
+#else
+		if (material.transparency < 1.0)
+			TotalLight.w = material.transparency;
+		result = TotalLight;
+#endif
 	}
+#endif
 
-	if (fog_on) {
+#ifdef FOG
+	{
 		float d = length(v_pos.xyz);
-		float w;
-		if (fog_factor_type == 0) {
-			if (d < fog_end)
-				w = (fog_end - d) / (fog_end - fog_start);
-			else
-				w = 0;
-		} else if (fog_factor_type == 1) {
-			w = exp(-(rho * d));
-		} else {
-			w = exp(-(rho * d) * (rho * d));
-		}
+#if FOG_FACTOR_TYPE == 0
+		float w = d < fog_end ? (fog_end - d) / (fog_end - fog_start) : 0.0;
+#elif FOG_FACTOR_TYPE == 1
+		float w = exp(-(rho * d));
+#else
+		float w = exp(-(rho * d) * (rho * d));
+#endif
 		result.rgb = mix(fog_colour, result.rgb, w);
 	}
+#endif
 
-	if (colouring_on) {
-		result = result * vec4(in_colour, transparency);
-	}
+#ifdef COLOURING
+	result = result * vec4(in_colour, v_transparency);
+#endif
 
 	o_color = result;
 }
@@ -0,0 +1,48 @@
+#include "bounds.hpp"
+
+Bounds Bounds::FromPoints(const std::vector<glm::vec3>& points) {
+    Bounds bounds;
+    if (points.empty())
+        return bounds;
+
+    bounds.min = bounds.max = points.front();
+    for (const auto& point : points) {
+        bounds.min = glm::min(bounds.min, point);
+        bounds.max = glm::max(bounds.max, point);
+    }
+
+    auto farthest = [&](const glm::vec3& from) {
+        return *std::max_element(points.begin(), points.end(), [&](const glm::vec3& a, const glm::vec3& b) { return glm::distance2(from, a) < glm::distance2(from, b); });
+    };
+    glm::vec3 a = farthest(points.front());
+    glm::vec3 b = farthest(a);
+
+    glm::vec3 center = (a + b) * 0.5f;
+    float radius = glm::distance(a, b) * 0.5f;
+    for (const auto& point : points) {
+        float distance = glm::distance(center, point);
+        if (distance <= radius)
+            continue;
+
+        // Just enough to reach the point, the opposite side of the sphere stays where it was
+        float grown = (radius + distance) * 0.5f;
+        center += (point - center) * ((grown - radius) / distance);
+        radius = grown;
+    }
+
+    glm::vec3 boxCenter = (bounds.min + bounds.max) * 0.5f;
+    float boxRadius = 0.0f;
+    for (const auto& point : points)
+        boxRadius = std::max(boxRadius, glm::distance2(boxCenter, point));
+    boxRadius = std::sqrt(boxRadius);
+
+    // Grown a little so rounding in the updates never leaves a point outside
+    bounds.sphere = boxRadius < radius ? glm::vec4{ boxCenter, boxRadius } : glm::vec4{ center, radius };
+    bounds.sphere.w *= 1.0f + 1e-5f;
+    return bounds;
+}
+
+glm::vec4 Bounds::getSphere(const glm::mat4& transform) const {
+    float scale = std::sqrt(std::max({ glm::length2(glm::vec3{ transform[0] }), glm::length2(glm::vec3{ transform[1] }), glm::length2(glm::vec3{ transform[2] }) }));
+    return { glm::vec3{ transform * glm::vec4{ glm::vec3{ sphere }, 1.0f } }, sphere.w * scale };
+}
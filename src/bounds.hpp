@@ -0,0 +1,15 @@
+#pragma once
+
+/// @brief Axis aligned box and bounding sphere around a set of points, in the space the points are given in
+/// The sphere comes from Ritter's algorithm: it starts between two points far apart and grows over every point
+/// left outside, within a few percent of the minimal sphere. The sphere around the box center is kept if smaller.
+struct Bounds {
+    glm::vec3 min{ 0.0f };
+    glm::vec3 max{ 0.0f };
+    glm::vec4 sphere{ 0.0f }; // center and radius
+
+    static Bounds FromPoints(const std::vector<glm::vec3>& points);
+
+    // Sphere after an affine transform, the radius scaled by its longest axis
+    glm::vec4 getSphere(const glm::mat4& transform) const;
+};
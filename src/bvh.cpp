@@ -0,0 +1,288 @@
+#include "bvh.hpp"
+#include "jobsystem.hpp"
+#include "profiler.hpp"
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace {
+    // Index of the highest set bit, the value must not be 0
+    uint32_t HighestBit(uint32_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+        return 31 - static_cast<uint32_t>(__builtin_clz(value));
+#elif defined(_MSC_VER)
+        unsigned long index;
+        _BitScanReverse(&index, value);
+        return static_cast<uint32_t>(index);
+#else
+        uint32_t bit = 0;
+        while (value >>= 1)
+            bit++;
+        return bit;
+#endif
+    }
+}
+
+void Bvh::build(const std::vector<glm::vec4>& spheres) {
+    PROFILE_SCOPE("bvh build");
+
+    this->spheres = spheres;
+    order.clear();
+    nodes.clear();
+    dirty.clear();
+    leaves.assign(spheres.size(), None);
+
+    glm::vec3 low{ std::numeric_limits<float>::max() };
+    glm::vec3 high{ std::numeric_limits<float>::lowest() };
+    for (uint32_t i = 0; i < spheres.size(); i++) {
+        if (spheres[i].w < 0.0f)
+            continue;
+        order.push_back(i);
+        low = glm::min(low, glm::vec3{ spheres[i] });
+        high = glm::max(high, glm::vec3{ spheres[i] });
+    }
+
+    auto count = static_cast<uint32_t>(order.size());
+    if (!count)
+        return;
+
+    // Centers quantized to 10 bits per axis over their bounds
+    glm::vec3 scale = 1023.0f / glm::max(high - low, glm::vec3{ 1e-6f });
+    std::vector<std::pair<uint32_t, uint32_t>> keys(count);
+    JobSystem::ParallelFor(0, count, 1024, [&](uint32_t first, uint32_t last) {
+        for (uint32_t i = first; i < last; i++)
+            keys[i] = { Morton((glm::vec3{ spheres[order[i]] } - low) * scale), order[i] };
+    });
+    std::sort(keys.begin(), keys.end());
+    for (uint32_t i = 0; i < count; i++)
+        order[i] = keys[i].second;
+
+    nodes.reserve(2 * (count / LeafSize) + 1);
+    nodes.push_back({ glm::vec3{ 0.0f }, 0, glm::vec3{ 0.0f }, count, 0, None });
+    std::vector<uint32_t> stack{ 0 };
+    while (!stack.empty()) {
+        uint32_t index = stack.back();
+        stack.pop_back();
+
+        uint32_t first = nodes[index].first;
+        uint32_t size = nodes[index].count;
+        if (size <= LeafSize) {
+            for (uint32_t i = first; i < first + size; i++)
+                leaves[order[i]] = index;
+            continue;
+        }
+
+        // Split where the highest bit that differs between the first and last code flips, in the middle if none does
+        uint32_t split = first + size / 2;
+        uint32_t differ = keys[first].first ^ keys[first + size - 1].first;
+        if (differ) {
+            uint32_t bit = 1u << HighestBit(differ);
+            auto begin = keys.begin() + first;
+            split = static_cast<uint32_t>(std::partition_point(begin, begin + size, [bit](const auto& key) { return !(key.first & bit); }) - keys.begin());
+        }
+
+        auto child = static_cast<uint32_t>(nodes.size());
+        nodes[index].child = child;
+        nodes.push_back({ glm::vec3{ 0.0f }, first, glm::vec3{ 0.0f }, split - first, 0, index });
+        nodes.push_back({ glm::vec3{ 0.0f }, split, glm::vec3{ 0.0f }, first + size - split, 0, index });
+        stack.push_back(child);
+        stack.push_back(child + 1);
+    }
+
+    // Children always come after their parent, fitting backwards sees them first
+    for (size_t i = nodes.size(); i-- > 0;)
+        fit(nodes[i]);
+}
+
+void Bvh::update(uint32_t item, const glm::vec4& sphere) {
+    spheres[item] = sphere;
+    if (leaves[item] != None)
+        dirty.push_back(leaves[item]);
+}
+
+void Bvh::refit() {
+    for (uint32_t leaf : dirty) {
+        for (uint32_t index = leaf; index != None; index = nodes[index].parent) {
+            auto& node = nodes[index];
+            glm::vec3 min = node.min;
+            glm::vec3 max = node.max;
+            fit(node);
+
+            // The ancestors already enclose an unchanged box
+            if (node.min == min && node.max == max)
+                break;
+        }
+    }
+    dirty.clear();
+}
+
+void Bvh::cull(const Frustum& frustum, std::vector<uint32_t>& visible) const {
+    PROFILE_SCOPE("bvh cull");
+
+    if (nodes.empty())
+        return;
+
+    // Bit p of a mask is set while plane p still has to be tested
+    std::vector<std::pair<uint32_t, uint32_t>> stack{ { 0, 0x3F } };
+    while (!stack.empty()) {
+        auto [index, mask] = stack.back();
+        stack.pop_back();
+
+        const auto& node = nodes[index];
+        glm::vec3 center = (node.min + node.max) * 0.5f;
+        glm::vec3 extent = (node.max - node.min) * 0.5f;
+        bool outside = false;
+        for (uint32_t p = 0; p < 6 && !outside; p++) {
+            if (!(mask & (1u << p)))
+                continue;
+
+            glm::vec3 normal{ frustum.planes[p] };
+            float distance = glm::dot(normal, center) + frustum.planes[p].w;
+            float reach = glm::dot(glm::abs(normal), extent);
+            outside = distance + reach <= 0.0f;
+            if (distance - reach > 0.0f)
+                mask &= ~(1u << p);
+        }
+
+        if (outside)
+            continue;
+
+        if (!mask) {
+            visible.insert(visible.end(), order.begin() + node.first, order.begin() + node.first + node.count);
+        } else if (node.child) {
+            stack.emplace_back(node.child, mask);
+            stack.emplace_back(node.child + 1, mask);
+        } else {
+            for (uint32_t i = node.first; i < node.first + node.count; i++) {
+                const auto& sphere = spheres[order[i]];
+                bool inside = true;
+                for (uint32_t p = 0; p < 6 && inside; p++) {
+                    const auto& plane = frustum.planes[p];
+                    inside = !(mask & (1u << p)) || plane.x * sphere.x + plane.y * sphere.y + plane.z * sphere.z + plane.w > -sphere.w;
+                }
+                if (inside)
+                    visible.push_back(order[i]);
+            }
+        }
+    }
+}
+
+void Bvh::query(const glm::vec3& center, float radius, std::vector<uint32_t>& items) const {
+    if (nodes.empty())
+        return;
+
+    std::vector<uint32_t> stack{ 0 };
+    while (!stack.empty()) {
+        const auto& node = nodes[stack.back()];
+        stack.pop_back();
+
+        glm::vec3 d = glm::max(node.min - center, 0.0f) + glm::max(center - node.max, 0.0f);
+        if (glm::dot(d, d) > radius * radius)
+            continue;
+
+        if (node.child) {
+            stack.push_back(node.child);
+            stack.push_back(node.child + 1);
+            continue;
+        }
+
+        for (uint32_t i = node.first; i < node.first + node.count; i++) {
+            const auto& sphere = spheres[order[i]];
+            float reach = radius + sphere.w;
+            if (sphere.w >= 0.0f && glm::distance2(glm::vec3{ sphere }, center) <= reach * reach)
+                items.push_back(order[i]);
+        }
+    }
+}
+
+std::optional<Bvh::Hit> Bvh::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const {
+    if (nodes.empty())
+        return std::nullopt;
+
+    glm::vec3 inverse = 1.0f / direction;
+    auto enter = [&](const Node& node) {
+        glm::vec3 t0 = (node.min - origin) * inverse;
+        glm::vec3 t1 = (node.max - origin) * inverse;
+        glm::vec3 near = glm::min(t0, t1);
+        glm::vec3 far = glm::max(t0, t1);
+        float tmin = std::max({ near.x, near.y, near.z, 0.0f });
+        float tmax = std::min({ far.x, far.y, far.z });
+        return tmin <= tmax ? tmin : std::numeric_limits<float>::infinity();
+    };
+
+    std::optional<Hit> hit;
+    float best = maxDistance;
+
+    // Nearer child on top, subtrees entered beyond the best hit so far are skipped
+    std::vector<std::pair<uint32_t, float>> stack{ { 0, enter(nodes[0]) } };
+    while (!stack.empty()) {
+        auto [index, distance] = stack.back();
+        stack.pop_back();
+        if (distance > best)
+            continue;
+
+        const auto& node = nodes[index];
+        if (node.child) {
+            float left = enter(nodes[node.child]);
+            float right = enter(nodes[node.child + 1]);
+            if (left < right) {
+                stack.emplace_back(node.child + 1, right);
+                stack.emplace_back(node.child, left);
+            } else {
+                stack.emplace_back(node.child, left);
+                stack.emplace_back(node.child + 1, right);
+            }
+            continue;
+        }
+
+        for (uint32_t i = node.first; i < node.first + node.count; i++) {
+            const auto& sphere = spheres[order[i]];
+            glm::vec3 offset = origin - glm::vec3{ sphere };
+            float b = glm::dot(offset, direction);
+            float c = glm::dot(offset, offset) - sphere.w * sphere.w;
+            float discriminant = b * b - c;
+            if (sphere.w < 0.0f || discriminant < 0.0f)
+                continue;
+
+            // Starting inside a sphere counts as hitting it right away
+            float t = c <= 0.0f ? 0.0f : -b - std::sqrt(discriminant);
+            if (t >= 0.0f && t <= best) {
+                best = t;
+                hit = Hit{ order[i], t };
+            }
+        }
+    }
+    return hit;
+}
+
+void Bvh::fit(Node& node) const {
+    if (node.child) {
+        node.min = glm::min(nodes[node.child].min, nodes[node.child + 1].min);
+        node.max = glm::max(nodes[node.child].max, nodes[node.child + 1].max);
+        return;
+    }
+
+    node.min = glm::vec3{ std::numeric_limits<float>::max() };
+    node.max = glm::vec3{ std::numeric_limits<float>::lowest() };
+    for (uint32_t i = node.first; i < node.first + node.count; i++) {
+        const auto& sphere = spheres[order[i]];
+        if (sphere.w < 0.0f)
+            continue;
+        node.min = glm::min(node.min, glm::vec3{ sphere } - sphere.w);
+        node.max = glm::max(node.max, glm::vec3{ sphere } + sphere.w);
+    }
+}
+
+uint32_t Bvh::Morton(const glm::vec3& position) {
+    // Spreads the low 10 bits of a value two bits apart
+    auto expand = [](float value) {
+        auto v = static_cast<uint32_t>(glm::clamp(value, 0.0f, 1023.0f));
+        v = (v * 0x00010001u) & 0xFF0000FFu;
+        v = (v * 0x00000101u) & 0x0F00F00Fu;
+        v = (v * 0x00000011u) & 0xC30C30C3u;
+        v = (v * 0x00000005u) & 0x49249249u;
+        return v;
+    };
+    return expand(position.x) << 2 | expand(position.y) << 1 | expand(position.z);
+}
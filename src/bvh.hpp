@@ -0,0 +1,57 @@
+#pragma once
+
+#include "frustum.hpp"
+
+/// @brief Bounding volume hierarchy over bounding spheres, for frustum culling, radius and ray queries
+/// Built as a linear BVH: items are sorted by the Morton code of their center and split top-down at the highest
+/// differing bit, which keeps every subtree a contiguous range of the sorted items. Moving items are refitted, only
+/// the boxes on the path from their leaf to the root are recomputed. Frustum traversal drops a plane for the whole
+/// subtree once a box lies fully inside it, and a subtree inside all six is emitted without testing its items.
+/// Items are indices into the spheres given to build. Ones with a negative radius are left out of the tree.
+class Bvh {
+public:
+    static constexpr uint32_t LeafSize = 4;
+
+    struct Hit {
+        uint32_t item;
+        float distance;
+    };
+
+    void build(const std::vector<glm::vec4>& spheres);
+
+    // Refitting keeps the tree valid but not tight, rebuild when items move far or join and leave
+    void update(uint32_t item, const glm::vec4& sphere);
+    void refit();
+
+    // Appends the items passing Frustum::checkSphere, in tree order
+    void cull(const Frustum& frustum, std::vector<uint32_t>& visible) const;
+    // Appends the items whose sphere overlaps the given one
+    void query(const glm::vec3& center, float radius, std::vector<uint32_t>& items) const;
+    // Nearest item whose sphere the ray enters, direction has to be normalized
+    std::optional<Hit> raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance = std::numeric_limits<float>::max()) const;
+
+    uint32_t size() const { return static_cast<uint32_t>(spheres.size()); }
+    uint32_t getNodeCount() const { return static_cast<uint32_t>(nodes.size()); }
+
+private:
+    static constexpr uint32_t None = ~0u;
+
+    // Inner nodes have their children at child and child + 1, leaves have child 0, the root is never a child
+    struct Node {
+        glm::vec3 min;
+        uint32_t first; // items of the subtree in order
+        glm::vec3 max;
+        uint32_t count;
+        uint32_t child;
+        uint32_t parent;
+    };
+
+    std::vector<glm::vec4> spheres; // by item
+    std::vector<uint32_t> order; // items sorted by Morton code
+    std::vector<uint32_t> leaves; // leaf holding each item, None when left out
+    std::vector<Node> nodes;
+    std::vector<uint32_t> dirty; // leaves to refit
+
+    void fit(Node& node) const;
+    static uint32_t Morton(const glm::vec3& position);
+};
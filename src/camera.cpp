@@ -3,7 +3,7 @@
 #include "input.hpp"
 
 // Constructor for camera -- initialise with some default values
-Camera::Camera(const glm::vec3& position, const glm::quat& rotation, float speed) : position{position}, rotation{rotation}, speed{speed} {
+Camera::Camera(const glm::vec3& position, const glm::quat& rotation, float speed) : position{position}, rotation{rotation}, previousPosition{position}, previousRotation{rotation}, speed{speed} {
 }
 
 // Update the camera to respond to mouse motion for rotations and keyboard for translation
@@ -31,6 +31,7 @@ void Camera::setViewByMouse() {
     }
 
     rotation = glm::quat{ glm::vec3{ pitch, yaw, 0 }};
+    previousRotation = rotation; // mouse look is applied per frame, not blended
 }
 
 // Update the camera to respond to key presses for translation
@@ -53,6 +54,13 @@ glm::mat4 Camera::getViewMatrix() const {
     return glm::lookAt(position, position + getForwardVector(), getUpVector());
 }
 
+// Return the camera view between the previous and the current simulation step
+glm::mat4 Camera::getViewMatrix(float alpha) const {
+    glm::vec3 eye = getPosition(alpha);
+    glm::quat rot = glm::slerp(previousRotation, rotation, alpha);
+    return glm::lookAt(eye, eye + rot * vec3::back, rot * vec3::up);
+}
+
 // Set the camera perspective projection matrix to produce a view frustum with a specific field of view, aspect ratio,
 // and near / far clipping planes
 void Camera::setPerspectiveProjectionMatrix(float fov, float aspectRatio, float nearClippingPlane, float farClippingPlane) {
@@ -28,6 +28,13 @@ public:
     // Gets the camera view
     glm::mat4 getViewMatrix() const;
 
+	// Remember the pose before a simulation step so rendering can blend between steps
+	void storePose() { previousPosition = position; previousRotation = rotation; }
+
+	// Gets the camera position and view blended from the previous step, alpha in [0, 1]
+	glm::vec3 getPosition(float alpha) const { return glm::mix(previousPosition, position, alpha); }
+	glm::mat4 getViewMatrix(float alpha) const;
+
 	// Set the projection matrices
 	void setPerspectiveProjectionMatrix(float fov, float aspectRatio, float nearClippingPlane, float farClippingPlane);
 	void setOrthographicProjectionMatrix(int width, int height);
@@ -35,6 +42,8 @@ public:
 private:
 	glm::vec3 position{ 0.0f };
 	glm::quat rotation{ 1, 0, 0, 0 };
+	glm::vec3 previousPosition{ 0.0f };
+	glm::quat previousRotation{ 1, 0, 0, 0 };
 
 	float speed{ 1.0f };
     float yaw{ 0.0f };
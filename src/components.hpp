@@ -1,6 +1,7 @@
 #pragma once
 
 #include "model.hpp"
+#include "occlusionculler.hpp"
 
 struct TransformComponent {
     glm::vec3 translation{0.0f};
@@ -13,11 +14,24 @@ struct TransformComponent {
                * glm::mat4_cast(rotation)
                * glm::scale(m, scale);
     };
+
+    // Sphere moved along, the radius scaled by the longest axis
+    glm::vec4 transformSphere(const glm::vec4& sphere) const {
+        return { translation + rotation * (scale * glm::vec3{ sphere }), sphere.w * glm::max(scale.x, scale.y, scale.z) };
+    }
+
+    static TransformComponent Lerp(const TransformComponent& from, const TransformComponent& to, float alpha) {
+        return { glm::mix(from.translation, to.translation, alpha), glm::slerp(from.rotation, to.rotation, alpha), glm::mix(from.scale, to.scale, alpha) };
+    }
+};
+
+// Transform at the previous simulation step, rendering blends it with the current one
+struct InterpolationComponent {
+    TransformComponent previous;
 };
 
 struct ModelComponent {
     std::shared_ptr<Model> model;
-    float radius{ 1.0f };
     float transparency{ 1.0f };
 
     std::shared_ptr<Model>& operator()() { return model; }
@@ -26,7 +40,6 @@ struct ModelComponent {
 
 struct MeshComponent {
     std::shared_ptr<Mesh> mesh;
-    float radius{ 1.0f };
     float transparency{ 1.0f };
 
     std::shared_ptr<Mesh>& operator()() { return mesh; }
@@ -42,4 +55,14 @@ struct ShipComponent {
 };
 
 struct BlinkComponent {
-};
\ No newline at end of file
+};
+
+// Never moves after creation, can be handed over to GPU culling
+struct StaticComponent {
+};
+
+// Simplified shape inside the entity's geometry, in its object space, that hides what lies behind it
+struct OccluderComponent {
+    std::shared_ptr<const OcclusionCuller::Occluder> occluder;
+    float radius{ 1.0f }; // bounding sphere of the occluder, unscaled
+};
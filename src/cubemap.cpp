@@ -1,10 +1,11 @@
 #include "cubemap.hpp"
 #include "image.hpp"
 #include "opengl.hpp"
+#include "glstate.hpp"
 
 Cubemap::Cubemap(const std::array<std::string, 6>& faces) {
     glCall(glGenTextures, 1, &textureId);
-    glCall(glBindTexture, GL_TEXTURE_CUBE_MAP, textureId);
+    GLState::BindTexture(0, GL_TEXTURE_CUBE_MAP, textureId);
 
     for (size_t i = 0; i < faces.size(); i++) {
         Image image{ faces[i] };
@@ -30,18 +31,14 @@ Cubemap::Cubemap(const std::array<std::string, 6>& faces) {
     glCall(glTexParameteri, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glCall(glTexParameteri, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 
-    glCall(glBindTexture, GL_TEXTURE_CUBE_MAP, 0);
+    GLState::BindTexture(0, GL_TEXTURE_CUBE_MAP, 0);
 }
 
 Cubemap::~Cubemap() {
+    GLState::ForgetTexture(textureId);
     glCall(glDeleteTextures, 1, &textureId);
 }
 
 void Cubemap::bind() const {
-    glCall(glActiveTexture, GL_TEXTURE0);
-    glCall(glBindTexture, GL_TEXTURE_CUBE_MAP, textureId);
-}
-
-void Cubemap::unbind() const {
-    glCall(glBindTexture, GL_TEXTURE_CUBE_MAP, 0);
+    GLState::BindTexture(0, GL_TEXTURE_CUBE_MAP, textureId);
 }
\ No newline at end of file
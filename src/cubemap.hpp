@@ -6,7 +6,6 @@ public:
     ~Cubemap();
 
     void bind() const;
-    void unbind() const;
 
 private:
     GLuint textureId;
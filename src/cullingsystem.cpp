@@ -0,0 +1,224 @@
+#include "cullingsystem.hpp"
+#include "jobsystem.hpp"
+#include "profiler.hpp"
+
+// The wider paths are compiled per function, so the binary still runs on CPUs without them
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define CULLING_X86
+#endif
+
+namespace {
+    struct Planes {
+        float x[6], y[6], z[6], w[6];
+    };
+
+    struct Spheres {
+        const float* x;
+        const float* y;
+        const float* z;
+        const float* radius;
+    };
+
+    // Each kernel writes the visible indices of [first, last) to out, which has room for last - first of them
+    using Kernel = uint32_t (*)(const Planes&, const Spheres&, uint32_t, uint32_t, uint32_t*);
+
+    uint32_t CullScalar(const Planes& planes, const Spheres& spheres, uint32_t first, uint32_t last, uint32_t* out) {
+        uint32_t count = 0;
+        for (uint32_t i = first; i < last; i++) {
+            bool inside = true;
+            for (int p = 0; p < 6; p++)
+                inside &= planes.x[p] * spheres.x[i] + planes.y[p] * spheres.y[i] + planes.z[p] * spheres.z[i] + planes.w[p] > -spheres.radius[i];
+            out[count] = i;
+            count += inside;
+        }
+        return count;
+    }
+
+#ifdef CULLING_X86
+    __attribute__((target("sse2")))
+    uint32_t CullSSE(const Planes& planes, const Spheres& spheres, uint32_t first, uint32_t last, uint32_t* out) {
+        uint32_t count = 0;
+        uint32_t i = first;
+        for (; i + 4 <= last; i += 4) {
+            __m128 x = _mm_loadu_ps(spheres.x + i);
+            __m128 y = _mm_loadu_ps(spheres.y + i);
+            __m128 z = _mm_loadu_ps(spheres.z + i);
+            __m128 limit = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(spheres.radius + i));
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (int p = 0; p < 6; p++) {
+                __m128 d = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes.x[p]), x), _mm_mul_ps(_mm_set1_ps(planes.y[p]), y));
+                d = _mm_add_ps(_mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(planes.z[p]), z)), _mm_set1_ps(planes.w[p]));
+                inside = _mm_and_ps(inside, _mm_cmpgt_ps(d, limit));
+            }
+
+            for (int mask = _mm_movemask_ps(inside); mask; mask &= mask - 1)
+                out[count++] = i + static_cast<uint32_t>(__builtin_ctz(mask));
+        }
+        return count + CullScalar(planes, spheres, i, last, out + count);
+    }
+
+    // Lane numbers of the set bits of every 8 bit mask, packed to the front
+    struct CompressTable {
+        alignas(32) uint32_t lanes[256][8]{};
+
+        CompressTable() {
+            for (uint32_t mask = 0; mask < 256; mask++) {
+                uint32_t count = 0;
+                for (uint32_t lane = 0; lane < 8; lane++) {
+                    if (mask & (1u << lane))
+                        lanes[mask][count++] = lane;
+                }
+            }
+        }
+    };
+
+    __attribute__((target("avx2")))
+    uint32_t CullAVX2(const Planes& planes, const Spheres& spheres, uint32_t first, uint32_t last, uint32_t* out) {
+        static const CompressTable table;
+
+        uint32_t count = 0;
+        uint32_t i = first;
+        for (; i + 8 <= last; i += 8) {
+            __m256 x = _mm256_loadu_ps(spheres.x + i);
+            __m256 y = _mm256_loadu_ps(spheres.y + i);
+            __m256 z = _mm256_loadu_ps(spheres.z + i);
+            __m256 limit = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(spheres.radius + i));
+            __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (int p = 0; p < 6; p++) {
+                __m256 d = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes.x[p]), x), _mm256_mul_ps(_mm256_set1_ps(planes.y[p]), y));
+                d = _mm256_add_ps(_mm256_add_ps(d, _mm256_mul_ps(_mm256_set1_ps(planes.z[p]), z)), _mm256_set1_ps(planes.w[p]));
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, limit, _CMP_GT_OQ));
+            }
+
+            // All 8 lanes are stored, the ones past count are overwritten by the next batch or left unused
+            int mask = _mm256_movemask_ps(inside);
+            __m256i lanes = _mm256_load_si256(reinterpret_cast<const __m256i*>(table.lanes[mask]));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + count), _mm256_add_epi32(lanes, _mm256_set1_epi32(static_cast<int>(i))));
+            count += static_cast<uint32_t>(__builtin_popcount(mask));
+        }
+        return count + CullScalar(planes, spheres, i, last, out + count);
+    }
+
+    __attribute__((target("avx512f")))
+    uint32_t CullAVX512(const Planes& planes, const Spheres& spheres, uint32_t first, uint32_t last, uint32_t* out) {
+        const __m512i lanes = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+
+        uint32_t count = 0;
+        uint32_t i = first;
+        for (; i + 16 <= last; i += 16) {
+            __m512 x = _mm512_loadu_ps(spheres.x + i);
+            __m512 y = _mm512_loadu_ps(spheres.y + i);
+            __m512 z = _mm512_loadu_ps(spheres.z + i);
+            __m512 limit = _mm512_sub_ps(_mm512_setzero_ps(), _mm512_loadu_ps(spheres.radius + i));
+            __mmask16 inside = 0xFFFF;
+            for (int p = 0; p < 6; p++) {
+                __m512 d = _mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(planes.x[p]), x), _mm512_mul_ps(_mm512_set1_ps(planes.y[p]), y));
+                d = _mm512_add_ps(_mm512_add_ps(d, _mm512_mul_ps(_mm512_set1_ps(planes.z[p]), z)), _mm512_set1_ps(planes.w[p]));
+                inside = _mm512_mask_cmp_ps_mask(inside, d, limit, _CMP_GT_OQ);
+            }
+
+            _mm512_mask_compressstoreu_epi32(out + count, inside, _mm512_add_epi32(lanes, _mm512_set1_epi32(static_cast<int>(i))));
+            count += static_cast<uint32_t>(__builtin_popcount(inside));
+        }
+        return count + CullScalar(planes, spheres, i, last, out + count);
+    }
+#endif
+
+    Kernel Select(CullingSystem::Isa isa) {
+        switch (isa) {
+#ifdef CULLING_X86
+            case CullingSystem::Isa::AVX512: return CullAVX512;
+            case CullingSystem::Isa::AVX2: return CullAVX2;
+            case CullingSystem::Isa::SSE: return CullSSE;
+#endif
+            default: return CullScalar;
+        }
+    }
+}
+
+void CullingSystem::resize(uint32_t count) {
+    x.resize(count, 0.0f);
+    y.resize(count, 0.0f);
+    z.resize(count, 0.0f);
+    radius.resize(count, -std::numeric_limits<float>::infinity());
+}
+
+void CullingSystem::set(uint32_t index, const glm::vec3& center, float radius) {
+    x[index] = center.x;
+    y[index] = center.y;
+    z[index] = center.z;
+    this->radius[index] = radius;
+}
+
+void CullingSystem::hide(uint32_t index) {
+    // No plane distance is above -radius
+    set(index, glm::vec3{ 0.0f }, -std::numeric_limits<float>::infinity());
+}
+
+void CullingSystem::cull(const Frustum& frustum, std::vector<uint32_t>& visible) const {
+    PROFILE_SCOPE("cull spheres");
+
+    Planes planes;
+    for (int p = 0; p < 6; p++) {
+        planes.x[p] = frustum.planes[p].x;
+        planes.y[p] = frustum.planes[p].y;
+        planes.z[p] = frustum.planes[p].z;
+        planes.w[p] = frustum.planes[p].w;
+    }
+
+    Spheres spheres{ x.data(), y.data(), z.data(), radius.data() };
+    Kernel kernel = Select(isa);
+
+    uint32_t count = size();
+    visible.resize(count);
+    if (count <= ChunkSize) {
+        visible.resize(kernel(planes, spheres, 0, count, visible.data()));
+        return;
+    }
+
+    // Every chunk fills its own range of the output, which is then closed up in order
+    uint32_t chunks = (count + ChunkSize - 1) / ChunkSize;
+    std::vector<uint32_t> found(chunks);
+    JobSystem::ParallelFor(0, chunks, 1, [&](uint32_t first, uint32_t last) {
+        for (uint32_t chunk = first; chunk < last; chunk++) {
+            uint32_t begin = chunk * ChunkSize;
+            found[chunk] = kernel(planes, spheres, begin, std::min(begin + ChunkSize, count), visible.data() + begin);
+        }
+    });
+
+    uint32_t kept = found[0];
+    for (uint32_t chunk = 1; chunk < chunks; chunk++) {
+        auto begin = visible.begin() + chunk * ChunkSize;
+        std::copy(begin, begin + found[chunk], visible.begin() + kept);
+        kept += found[chunk];
+    }
+    visible.resize(kept);
+}
+
+CullingSystem::Isa CullingSystem::GetSupportedIsa() {
+#ifdef CULLING_X86
+    static const Isa supported = [] {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f"))
+            return Isa::AVX512;
+        if (__builtin_cpu_supports("avx2"))
+            return Isa::AVX2;
+        if (__builtin_cpu_supports("sse2"))
+            return Isa::SSE;
+        return Isa::Scalar;
+    }();
+    return supported;
+#else
+    return Isa::Scalar;
+#endif
+}
+
+const char* CullingSystem::GetName(Isa isa) {
+    switch (isa) {
+        case Isa::AVX512: return "AVX-512";
+        case Isa::AVX2: return "AVX2";
+        case Isa::SSE: return "SSE";
+        default: return "scalar";
+    }
+}
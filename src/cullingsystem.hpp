@@ -0,0 +1,36 @@
+#pragma once
+
+#include "frustum.hpp"
+
+/// @brief World space bounding spheres in structure-of-arrays form, culled against a frustum in batches
+/// Every plane is tested against 4, 8 or 16 spheres at once with SSE, AVX2 or AVX-512, picked at runtime from what
+/// the CPU supports, and a scalar loop covers the remainder. Sets larger than a chunk are culled on the job system.
+/// Slots belong to the caller, e.g. one per entity of a group, and only need rewriting when their transform changes.
+class CullingSystem {
+public:
+    enum class Isa { Scalar, SSE, AVX2, AVX512 };
+
+    CullingSystem() : isa{ GetSupportedIsa() } {}
+
+    void resize(uint32_t count); // new slots are hidden
+    uint32_t size() const { return static_cast<uint32_t>(radius.size()); }
+
+    void set(uint32_t index, const glm::vec3& center, float radius);
+    void hide(uint32_t index); // never visible, for objects culled somewhere else
+    glm::vec4 getSphere(uint32_t index) const { return { x[index], y[index], z[index], radius[index] }; }
+
+    // Replaces visible with the slots passing Frustum::checkSphere, in increasing order
+    void cull(const Frustum& frustum, std::vector<uint32_t>& visible) const;
+
+    void setIsa(Isa isa) { this->isa = std::min(isa, GetSupportedIsa()); }
+    Isa getIsa() const { return isa; }
+
+    static Isa GetSupportedIsa();
+    static const char* GetName(Isa isa);
+
+private:
+    static constexpr uint32_t ChunkSize = 16384; // spheres per job
+
+    std::vector<float> x, y, z, radius;
+    Isa isa;
+};
@@ -0,0 +1,71 @@
+#include "filewatcher.hpp"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+FileWatcher::FileWatcher(std::filesystem::path directory) : directory{std::move(directory)} {
+#ifdef __linux__
+    fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "ERROR: inotify_init1 failed: " << std::strerror(errno) << std::endl;
+        return;
+    }
+
+    watch = inotify_add_watch(fd, this->directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (watch < 0) {
+        std::cerr << "ERROR: Cannot watch " << this->directory.string() << ": " << std::strerror(errno) << std::endl;
+        return;
+    }
+
+    running = true;
+    thread = std::thread{ &FileWatcher::loop, this };
+#else
+    std::cerr << "ERROR: File watching is only implemented with inotify" << std::endl;
+#endif
+}
+
+FileWatcher::~FileWatcher() {
+    running = false;
+    if (thread.joinable())
+        thread.join();
+
+#ifdef __linux__
+    if (fd >= 0)
+        close(fd);
+#endif
+}
+
+std::vector<std::filesystem::path> FileWatcher::poll() {
+    std::lock_guard lock{ mutex };
+    std::vector<std::filesystem::path> files{ changed.begin(), changed.end() };
+    changed.clear();
+    return files;
+}
+
+void FileWatcher::loop() {
+#ifdef __linux__
+    alignas(inotify_event) char buffer[4096];
+
+    while (running) {
+        // Wake up now and then to notice the destructor
+        pollfd descriptor{ fd, POLLIN, 0 };
+        if (::poll(&descriptor, 1, 100) <= 0)
+            continue;
+
+        ssize_t length = read(fd, buffer, sizeof(buffer));
+        if (length <= 0)
+            continue;
+
+        std::lock_guard lock{ mutex };
+        for (ssize_t offset = 0; offset < length;) {
+            const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            if (event->len > 0)
+                changed.insert(directory / event->name);
+            offset += sizeof(inotify_event) + event->len;
+        }
+    }
+#endif
+}
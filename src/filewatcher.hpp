@@ -0,0 +1,27 @@
+#pragma once
+
+/// @brief Collects the files in one directory that were written since the last poll
+/// On Linux a thread waits on inotify for files being closed after writing or renamed into place (how most editors
+/// save). Elsewhere nothing is ever reported. poll() may be called from any thread, it never blocks on the disk.
+class FileWatcher {
+public:
+    explicit FileWatcher(std::filesystem::path directory);
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    std::vector<std::filesystem::path> poll();
+    bool isWatching() const { return watch >= 0; }
+
+private:
+    std::filesystem::path directory;
+    int fd{ -1 };
+    int watch{ -1 };
+    std::atomic<bool> running{ false };
+    std::thread thread;
+    std::mutex mutex;
+    std::set<std::filesystem::path> changed; // an editor saving often triggers several events for one file
+
+    void loop();
+};
@@ -1,5 +1,6 @@
 #include "font.hpp"
 #include "opengl.hpp"
+#include "glstate.hpp"
 
 //#define STB_IMAGE_WRITE_IMPLEMENTATION
 //#include <stb_image_write.h>
@@ -53,7 +54,7 @@ Font::Font(const FontFace& face, int size) {
     }
 
     glCall(glGenTextures, 1, &textureId);
-    glCall(glBindTexture, GL_TEXTURE_2D, textureId);
+    GLState::BindTexture(0, GL_TEXTURE_2D, textureId);
     glCall(glPixelStorei, GL_UNPACK_ALIGNMENT, 1); // disable byte-alignment restriction
 
     glCall(glTexImage2D, GL_TEXTURE_2D, 0, GL_R8, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, pixels.data());
@@ -70,14 +71,10 @@ Font::Font(const FontFace& face, int size) {
 }
 
 Font::~Font() {
+    GLState::ForgetTexture(textureId);
     glCall(glDeleteTextures, 1, &textureId);
 }
 
 void Font::bind() const {
-    glCall(glActiveTexture, GL_TEXTURE0);
-    glCall(glBindTexture, GL_TEXTURE_2D, textureId);
-}
-
-void Font::unbind() const {
-    glCall(glBindTexture, GL_TEXTURE_2D, 0);
+    GLState::BindTexture(0, GL_TEXTURE_2D, textureId);
 }
\ No newline at end of file
@@ -15,7 +15,6 @@ public:
     ~Font();
 
     void bind() const;
-    void unbind() const;
 
 private:
     GLuint textureId;
@@ -0,0 +1,60 @@
+#include "framebuffer.hpp"
+#include "opengl.hpp"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+Framebuffer::Framebuffer(int width, int height) : width{width}, height{height} {
+    glCall(glGenRenderbuffers, 1, &color);
+    glCall(glBindRenderbuffer, GL_RENDERBUFFER, color);
+    glCall(glRenderbufferStorage, GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+    glCall(glGenRenderbuffers, 1, &depth);
+    glCall(glBindRenderbuffer, GL_RENDERBUFFER, depth);
+    glCall(glRenderbufferStorage, GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glCall(glBindRenderbuffer, GL_RENDERBUFFER, 0);
+
+    glCall(glGenFramebuffers, 1, &fbo);
+    glCall(glBindFramebuffer, GL_FRAMEBUFFER, fbo);
+    glCall(glFramebufferRenderbuffer, GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+    glCall(glFramebufferRenderbuffer, GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth);
+
+    GLenum status = glCall(glCheckFramebufferStatus, GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "ERROR: Framebuffer is incomplete: " << std::hex << status << std::dec << std::endl;
+    }
+
+    glCall(glBindFramebuffer, GL_FRAMEBUFFER, 0);
+}
+
+Framebuffer::~Framebuffer() {
+    glCall(glDeleteFramebuffers, 1, &fbo);
+    glCall(glDeleteRenderbuffers, 1, &color);
+    glCall(glDeleteRenderbuffers, 1, &depth);
+}
+
+void Framebuffer::bind() const {
+    glCall(glBindFramebuffer, GL_FRAMEBUFFER, fbo);
+}
+
+void Framebuffer::unbind() const {
+    glCall(glBindFramebuffer, GL_FRAMEBUFFER, 0);
+}
+
+bool Framebuffer::save(const std::filesystem::path& path) const {
+    std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+
+    glCall(glBindFramebuffer, GL_READ_FRAMEBUFFER, fbo);
+    glCall(glReadBuffer, GL_COLOR_ATTACHMENT0);
+    glCall(glPixelStorei, GL_PACK_ALIGNMENT, 1);
+    glCall(glReadPixels, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    glCall(glBindFramebuffer, GL_READ_FRAMEBUFFER, 0);
+
+    // GL rows start at the bottom
+    stbi_flip_vertically_on_write(1);
+    if (!stbi_write_png(path.string().c_str(), width, height, 4, pixels.data(), width * 4)) {
+        std::cerr << "ERROR: Failed to write frame: \"" << path.string() << "\"" << std::endl;
+        return false;
+    }
+    return true;
+}
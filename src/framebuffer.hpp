@@ -0,0 +1,25 @@
+#pragma once
+
+/// @brief Offscreen colour and depth target
+/// Headless runs draw into this instead of the default framebuffer, which may not exist.
+class Framebuffer {
+public:
+    Framebuffer(int width, int height);
+    ~Framebuffer();
+
+    void bind() const;
+    void unbind() const;
+
+    // Reads the colour attachment back and writes it as PNG, stalls until the frame is finished
+    bool save(const std::filesystem::path& path) const;
+
+    GLuint getId() const { return fbo; }
+    glm::ivec2 getSize() const { return { width, height }; }
+
+private:
+    GLuint fbo;
+    GLuint color;
+    GLuint depth;
+    int width;
+    int height;
+};
@@ -20,13 +20,9 @@ public:
         planes[BACK] = {mat[0][3] + mat[0][2], mat[1][3] + mat[1][2], mat[2][3] + mat[2][2], mat[3][3] + mat[3][2]};
         planes[FRONT] = {mat[0][3] - mat[0][2], mat[1][3] - mat[1][2], mat[2][3] - mat[2][2], mat[3][3] - mat[3][2]};
 
-        /*for (auto& plane : planes) {
-            float length = sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
-            plane /= length;
-        }*/
-
+        // Unit normals, so the plane distances below are in world units and comparable to a radius
         for (auto& plane : planes) {
-            plane = glm::normalize(plane);
+            plane /= glm::length(glm::vec3{ plane });
         }
     }
 
@@ -6,36 +6,99 @@
 #include "poissonsampling.hpp"
 #include "random.hpp"
 #include "extentions.hpp"
+#include "jobsystem.hpp"
+#include "framebuffer.hpp"
+#include "profiler.hpp"
+#include "glstate.hpp"
+#include "shadercache.hpp"
+#include "lightclusters.hpp"
+#include "filewatcher.hpp"
 
 // Constructor
-Game::Game() : window{ "OpenGL Template", { 1280, 720 }}, camera{ {0.0f, 10.0f, 100.0f}, {1, 0, 0, 0}, 50.0f } {
+Game::Game() : window{ "OpenGL Template", resolution, backend }, camera{ {0.0f, 10.0f, 100.0f}, {1, 0, 0, 0}, 50.0f } {
     Input::Setup(window);
+
+    // Entities joining or leaving the model group, or starting and stopping to move, reassign the culling slots
+    registry.on_construct<TransformComponent>().connect<&Game::invalidateModelBounds>(*this);
+    registry.on_destroy<TransformComponent>().connect<&Game::invalidateModelBounds>(*this);
+    registry.on_construct<ModelComponent>().connect<&Game::invalidateModelBounds>(*this);
+    registry.on_destroy<ModelComponent>().connect<&Game::invalidateModelBounds>(*this);
+    registry.on_construct<StaticComponent>().connect<&Game::invalidateModelBounds>(*this);
+    registry.on_destroy<StaticComponent>().connect<&Game::invalidateModelBounds>(*this);
 }
 
 // Destructor
 Game::~Game() {
+    Profiler::Shutdown();
 }
 
 // Initialisation:  This method only runs once at startup
 void Game::init() {
+    GLDebug::Init(glDebugMode);
+
+    if (!tracePath.empty())
+        Profiler::BeginCapture();
+
+    Profiler::SetThreadName("main");
+    Profiler::Init();
+
+    PROFILE_SCOPE("init");
+
     // Set the clear colour and depth
     glCall(glClearColor, 1.0f, 1.0f, 1.0f, 1.0f);
     glCall(glClearStencil, 0);
     glCall(glClearDepth, 1.0f);
-    glCall(glEnable, GL_BLEND);
-    glCall(glBlendFunc, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glCall(glEnable, GL_CULL_FACE);
+    GLState::Enable(GL_BLEND);
+    GLState::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GLState::Enable(GL_CULL_FACE);
     glCall(glEnable, GL_LIGHTING);
     glCall(glEnable, GL_TEXTURE_2D);
-    glCall(glEnable, GL_DEPTH_TEST);
+    GLState::Enable(GL_DEPTH_TEST);
     glCall(glEnable, GL_COLOR_MATERIAL);
-    glCall(glDepthFunc, GL_LEQUAL);
+    GLState::DepthFunc(GL_LEQUAL);
     glCall(glShadeModel, GL_SMOOTH);
     glCall(glPixelStorei, GL_UNPACK_ALIGNMENT, 4);
     glCall(glPointSize, 7.0f);
 
-    mainShader = std::make_unique<Shader>();
-    mainShader->link("resources/shaders/mainShader.vert", "resources/shaders/mainShader.frag");
+    // Without a display there may be no default framebuffer to draw into
+    if (window.isHeadless()) {
+        framebuffer = std::make_unique<Framebuffer>(window.getWidth(), window.getHeight());
+    }
+
+    if (!dumpPath.empty()) {
+        std::filesystem::create_directories(dumpPath);
+        Shader::SetAsync(false); // every dumped frame shows the whole scene
+    }
+
+    if (gpuCulling) {
+        mergeGeometry = true;
+    }
+
+    if (mergeGeometry) {
+        geometryArena = std::make_unique<GeometryArena>(1 << 20, 1 << 22);
+    }
+
+    // Feature combinations of the main shader are compiled on first use, constant uniforms are set once per variant
+    mainShaders = std::make_unique<ShaderVariants>("resources/shaders/mainShader.vert", "resources/shaders/mainShader.frag", MainShaderDefines,
+        [](Shader& shader, uint32_t variant) {
+            if (variant & FeatureFog) {
+                shader.setUniform("fog_colour", glm::vec3{ 0.5f });
+                shader.setUniform("fog_start", 20.0f);
+                shader.setUniform("fog_end", 1000.0f);
+            }
+            if (variant & FeatureLighting) {
+                shader.setUniform("gMatSpecularIntensity", 1.0f);
+                shader.setUniform("gSpecularPower", 10.0f);
+            }
+        });
+
+    // Per-frame dynamic data (instances, text quads) is written through one persistently mapped ring
+    streamBuffer = std::make_unique<StreamBuffer>(8 * 1024 * 1024);
+    renderQueue = std::make_unique<RenderQueue>(*streamBuffer);
+    lightBuffer = std::make_unique<LightBuffer>();
+    // With object lights the clusters only serve the compute culled statics
+    if (clusteredLighting && (!objectLights || gpuCulling))
+        lightClusters = std::make_unique<LightClusters>(*streamBuffer);
 
     // Initialise lights
     directionalLight.color = glm::vec3{ 1.0f, 1.0f, 1.0f };
@@ -43,20 +106,6 @@ void Game::init() {
     directionalLight.diffuseIntensity = darkMode ? 0.1f : 1.0f;
     directionalLight.direction = glm::normalize(glm::vec3{ 0.0f, -1.0f, 0.0f });
 
-    mainShader->use();
-    mainShader->setUniform("fog_on", true);
-    mainShader->setUniform("fog_colour", glm::vec3{ 0.5f });
-    mainShader->setUniform("fog_factor_type", 0);
-    mainShader->setUniform("fog_start", 20.0f);
-    mainShader->setUniform("fog_end", 1000.0f);
-
-    mainShader->setUniform("colouring_on", false);
-    mainShader->setUniform("has_texture", true);
-    mainShader->setUniform("lighting_on", true);
-    mainShader->setUniform("gMatSpecularIntensity", 1.0f);
-    mainShader->setUniform("gSpecularPower", 10.0f);
-
-    directionalLight.submit(mainShader);
 
     // Generate path for pipe
 
@@ -75,15 +124,28 @@ void Game::init() {
 
     auto tube = registry.create();
     registry.emplace<TransformComponent>(tube);
-    registry.emplace<MeshComponent>(tube, geometry::tube(catmullRom.getControlPoints(), 30.0f, 48, std::make_unique<Texture>(150, 0, 150)), FLT_MAX / 2.0f);
+    registry.emplace<MeshComponent>(tube, geometry::tube(catmullRom.getControlPoints(), 30.0f, 48, std::make_unique<Texture>(150, 0, 150)));
 
     auto t = geometry::torus(24, 72, 35.0f, 7.5f, std::make_shared<Texture>("resources/textures/magic.png", true, false));
+    auto torusOccluder = OcclusionCuller::Torus(35.0f, 7.5f);
+
+    // Occluder bounds from its own points, widened to a sphere around the origin as the component expects
+    std::vector<glm::vec3> torusPoints;
+    for (const auto& part : torusOccluder->parts)
+        torusPoints.insert(torusPoints.end(), part.begin(), part.end());
+    auto torusSphere = Bounds::FromPoints(torusPoints).sphere;
+    float torusRadius = glm::length(glm::vec3{ torusSphere }) + torusSphere.w;
     auto& p = catmullRom.getCentrelinePoints();
     auto& n = catmullRom.getCentrelineNormals();
-    for (int i = 0; i < p.size(); i += 30) {
+    size_t tori = torusCount < 0 ? (p.size() + 29) / 30 : static_cast<size_t>(torusCount);
+    for (size_t k = 0; k < tori; k++) {
+        // Every 30th point by default as the scene always had, spread evenly when a count is asked for
+        size_t i = torusCount < 0 ? k * 30 : k * p.size() / tori;
         auto entity = registry.create();
         registry.emplace<TransformComponent>(entity, p[i], glm::quatLookAt(n[i], vec3::up), glm::vec3{1.0f});
-        registry.emplace<MeshComponent>(entity, t, 35.0f);
+        registry.emplace<MeshComponent>(entity, t);
+        registry.emplace<OccluderComponent>(entity, torusOccluder, torusRadius);
+        registry.emplace<StaticComponent>(entity);
     }
 
     auto tetrahedron = registry.create();
@@ -106,6 +168,11 @@ void Game::init() {
         Model::Load("resources/models/Asteroids/Asteroid_10.fbx")
     };
 
+    // The largest sphere inside each asteroid hides what is behind it
+    std::vector<std::shared_ptr<const OcclusionCuller::Occluder>> asteroidOccluders;
+    for (const auto& model : asteroidsModels)
+        asteroidOccluders.push_back(OcclusionCuller::Sphere(model->getInnerRadius()));
+
     // Create entities
 
     glm::vec3& initial = catmullRom.getCentrelinePoints()[0];
@@ -113,8 +180,12 @@ void Game::init() {
 
     spaceship = registry.create();
     registry.emplace<TransformComponent>(spaceship, initial);
-    registry.emplace<ModelComponent>(spaceship, Model::Load("resources/models/Ship/SpaceShip_final.fbx"));
+    auto shipModel = Model::Load("resources/models/Ship/SpaceShip_final.fbx");
+    registry.emplace<ModelComponent>(spaceship, shipModel);
     registry.emplace<ShipComponent>(spaceship);
+    if (float radius = shipModel->getInnerRadius(); radius > 0.0f)
+        registry.emplace<OccluderComponent>(spaceship, OcclusionCuller::Sphere(radius), radius);
+    registry.emplace<InterpolationComponent>(spaceship, registry.get<TransformComponent>(spaceship));
     auto& spotLight = registry.emplace<SpotLight>(spaceship);
     spotLight.position = initial + direction * 5.0f;
     spotLight.color = glm::vec3{ 1.0f, 0.0f, 0.0f };
@@ -128,10 +199,66 @@ void Game::init() {
     pointLight.ambientIntensity = 2.25f;
     pointLight.diffuseIntensity = 3.6f;
 
-    for (const auto& v : poisson::diskSampler2D(50, {1000, 1000}, 50)) {
+    std::vector<glm::vec2> field;
+    if (asteroidCount < 0) {
+        field = poisson::diskSampler2D(50, {1000, 1000}, 50);
+    } else {
+        for (int i = 0; i < asteroidCount; i++)
+            field.emplace_back(Random::FloatRange(0.0f, 1000.0f), Random::FloatRange(0.0f, 1000.0f));
+    }
+
+    for (const auto& v : field) {
         auto entity = registry.create();
         registry.emplace<TransformComponent>(entity, glm::vec3{v.x - 500.0f, Random::FloatRange(-300.0f, 300.0f), v.y - 500.0f}, glm::quat{{ Random::FloatValue(), Random::FloatValue(), Random::FloatValue() }}, glm::vec3{2.5f});
-        registry.emplace<ModelComponent>(entity, asteroidsModels[Random::IntRange(0, static_cast<int>(asteroidsModels.size()) - 1)], 5.0f);
+        auto index = Random::IntRange(0, static_cast<int>(asteroidsModels.size()) - 1);
+        registry.emplace<ModelComponent>(entity, asteroidsModels[index]);
+        if (float radius = asteroidsModels[index]->getInnerRadius(); radius > 0.0f)
+            registry.emplace<OccluderComponent>(entity, asteroidOccluders[index], radius);
+        registry.emplace<StaticComponent>(entity);
+    }
+
+    // Extra lights spread along the path
+    for (uint32_t k = 0; k < pointLightCount; k++) {
+        size_t i = k * p.size() / pointLightCount;
+        auto& light = registry.emplace<PointLight>(registry.create());
+        light.position = p[i] + vec3::up * 20.0f;
+        light.color = glm::vec3{ Random::FloatValue(), Random::FloatValue(), Random::FloatValue() };
+        light.ambientIntensity = 0.5f;
+        light.diffuseIntensity = 2.0f;
+        light.attenuation.exp = 0.05f; // a range of about 130 units, so they stay local
+    }
+
+    for (uint32_t k = 0; k < spotLightCount; k++) {
+        size_t i = (2 * k + 1) * p.size() / (2 * spotLightCount);
+        auto& light = registry.emplace<SpotLight>(registry.create());
+        light.position = p[i] + vec3::up * 40.0f;
+        light.direction = -vec3::up;
+        light.color = glm::vec3{ Random::FloatValue(), Random::FloatValue(), Random::FloatValue() };
+        light.ambientIntensity = 10.0f;
+        light.diffuseIntensity = 10.0f;
+        light.cutoff = 0.9f;
+        light.attenuation.exp = 0.05f;
+    }
+
+    // Hand static entities over to the compute culling pass
+    if (gpuCulling) {
+        gpuCuller = std::make_unique<GpuCuller>();
+
+        auto statics = registry.view<const TransformComponent, const StaticComponent>();
+        for (auto entity : statics) {
+            const auto& transform = registry.get<TransformComponent>(entity);
+
+            glm::mat4 transformMatrix{ transform };
+            glm::mat3 normalMatrix{ glm::transpose(glm::inverse(glm::mat3{ transformMatrix })) };
+
+            if (auto model = registry.try_get<ModelComponent>(entity)) {
+                gpuCuller->add(model->model.get(), { transformMatrix, normalMatrix, model->transparency }, transform.transformSphere(model->model->getBounds().sphere));
+            } else if (auto mesh = registry.try_get<MeshComponent>(entity)) {
+                gpuCuller->add(mesh->mesh.get(), { transformMatrix, normalMatrix, mesh->transparency }, transform.transformSphere(mesh->mesh->getBounds().sphere));
+            }
+        }
+
+        gpuCuller->build();
     }
 
     //////////////////////////////////////////////////////////////
@@ -149,12 +276,12 @@ void Game::init() {
     skybox = std::make_unique<Skybox>(faces);
 
     skyboxShader = std::make_unique<Shader>();
-    skyboxShader->link("resources/shaders/skyboxShader.vert", "resources/shaders/skyboxShader.frag");
+    skyboxShader->linkAsync("resources/shaders/skyboxShader.vert", "resources/shaders/skyboxShader.frag");
 
     //////////////////////////////////////////////////////////////
 
     splineShader = std::make_unique<Shader>();
-    splineShader->link("resources/shaders/splineShader.vert", "resources/shaders/splineShader.frag");
+    splineShader->linkAsync("resources/shaders/splineShader.vert", "resources/shaders/splineShader.frag");
 
     //////////////////////////////////////////////////////////////
 
@@ -164,155 +291,413 @@ void Game::init() {
     FontFace icon_face{ library, "resources/fonts/Font90Icons-2ePo.ttf" };
 
     textShader = std::make_unique<Shader>();
-    textShader->link("resources/shaders/textShader.vert", "resources/shaders/textShader.frag");
+    textShader->linkAsync("resources/shaders/textShader.vert", "resources/shaders/textShader.frag");
 
-    textMesh = std::make_unique<TextMesh>();
+    textMesh = std::make_unique<TextMesh>(*streamBuffer);
     font = std::make_unique<Font>(roboto_face, 32);
     icons = std::make_unique<Font>(icon_face, 32);
+
+    if (hotReload)
+        shaderWatcher = std::make_unique<FileWatcher>("resources/shaders");
+
+    if (ShaderCache::Enabled())
+        std::cout << "Shader cache: " << ShaderCache::GetHits() << " programs loaded, " << ShaderCache::GetMisses() << " compiled" << std::endl;
 }
 
-// Render method runs repeatedly in a loop
-void Game::render() {
-    // Clear the buffers and enable depth testing (z-buffering)
-    glCall(glClear, GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glCall(glEnable, GL_DEPTH_TEST);
-
-    // Get camera view and proj matricies
-    auto viewMatrix = camera.getViewMatrix();
-    auto projMatrix = camera.getPerspectiveProjectionMatrix();
-    auto viewProjMatrix = projMatrix * viewMatrix;
-
-    // Use the main shader program
-    mainShader->use();
-    mainShader->setUniform("u_view_projection", viewProjMatrix);
-    mainShader->setUniform("gEyeWorldPos", camera.getPosition());
-    mainShader->setUniform("fog_on", darkMode);
-    directionalLight.ambientIntensity = darkMode ? 0.15f : 1.0f;
-    directionalLight.diffuseIntensity = darkMode ? 0.1f : 1.0f;
-    directionalLight.submit(mainShader);
+// Collect everything the frame needs from the simulation state, the GL thread only sees the snapshot
+void Game::snapshot(RenderSnapshot& frame) {
+    PROFILE_SCOPE("snapshot");
 
-    // Render scene
-    frustum.update(viewProjMatrix);
+    frame.frame = frameNumber;
+    frame.size = window.getSize();
+    frame.view = camera.getViewMatrix(alpha);
+    frame.projection = camera.getPerspectiveProjectionMatrix();
+    frame.orthographic = camera.getOrthographicProjectionMatrix();
+    frame.eye = camera.getPosition(alpha);
+    frame.darkMode = darkMode;
+    frame.wireframe = window.Wireframe();
+
+    frustum.update(frame.projection * frame.view);
+    frame.frustum = frustum;
 
+    // Model bounding spheres keep their slots until the group changes, then only moving ones are refreshed
     auto group = registry.group<TransformComponent>(entt::get<ModelComponent>, entt::exclude<ShipComponent>);
-    for (auto entity : group) {
-        auto [transform, model] = group.get<TransformComponent, ModelComponent>(entity);
+    auto modelSphere = [&](entt::entity entity) {
+        auto [current, model] = group.get<TransformComponent, ModelComponent>(entity);
+        return interpolated(entity, current).transformSphere(model()->getBounds().sphere);
+    };
 
-        if (frustum.checkSphere(transform.translation, model.radius * glm::max(transform.scale.x, transform.scale.y, transform.scale.z))) {
-            glm::mat4 transformMatrix{ transform };
-            glm::mat3 normalMatrix{ glm::transpose(glm::inverse(glm::mat3{ transformMatrix })) };
+    if (modelBoundsDirty) {
+        auto count = static_cast<uint32_t>(group.size());
+        modelEntities.assign(group.begin(), group.end());
+        modelCulling.resize(count);
+        JobSystem::ParallelFor(0, count, 1024, [&](uint32_t first, uint32_t last) {
+            for (uint32_t i = first; i < last; i++) {
+                auto entity = modelEntities[i];
+                if (gpuCuller && registry.try_get<StaticComponent>(entity)) {
+                    modelCulling.hide(i);
+                } else {
+                    auto sphere = modelSphere(entity);
+                    modelCulling.set(i, glm::vec3{ sphere }, sphere.w);
+                }
+            }
+        });
+
+        movingModels.clear();
+        std::vector<glm::vec4> spheres(count);
+        for (uint32_t i = 0; i < count; i++) {
+            if (!registry.try_get<StaticComponent>(modelEntities[i]))
+                movingModels.push_back(i);
+            spheres[i] = modelCulling.getSphere(i);
+        }
 
-            mainShader->setUniform("u_transform", transformMatrix);
-            mainShader->setUniform("u_normal", normalMatrix);
-            mainShader->setUniform("transparency", model.transparency);
-            model()->render(mainShader);
+        if (bvhCulling)
+            modelBvh.build(spheres);
+        modelBoundsDirty = false;
+    } else {
+        for (auto i : movingModels) {
+            auto sphere = modelSphere(modelEntities[i]);
+            modelCulling.set(i, glm::vec3{ sphere }, sphere.w);
+            if (bvhCulling)
+                modelBvh.update(i, sphere);
         }
+        if (bvhCulling)
+            modelBvh.refit();
     }
 
-    auto meshes = registry.view<const TransformComponent, const MeshComponent>();
-    for (auto [entity, transform, mesh] : meshes.each()) {
-        if (frustum.checkSphere(transform.translation, mesh.radius * glm::max(transform.scale.x, transform.scale.y, transform.scale.z))) {
+    // Then build instance data for the visible ones on the workers
+    visibleModels.clear();
+    if (bvhCulling)
+        modelBvh.cull(frustum, visibleModels);
+    else
+        modelCulling.cull(frustum, visibleModels);
+
+    occludedCount = 0;
+    if (occlusionCulling)
+        cullOccluded(frame);
+
+    frame.models.resize(visibleModels.size());
+    modelSpheres.resize(visibleModels.size());
+    meshSpheres.clear();
+    JobSystem::ParallelFor(0, static_cast<uint32_t>(visibleModels.size()), 64, [&](uint32_t first, uint32_t last) {
+        for (uint32_t i = first; i < last; i++) {
+            auto entity = modelEntities[visibleModels[i]];
+            auto [current, model] = group.get<TransformComponent, ModelComponent>(entity);
+            auto transform = interpolated(entity, current);
+
             glm::mat4 transformMatrix{ transform };
             glm::mat3 normalMatrix{ glm::transpose(glm::inverse(glm::mat3{ transformMatrix })) };
 
-            mainShader->setUniform("u_transform", transformMatrix);
-            mainShader->setUniform("u_normal", normalMatrix);
-            mainShader->setUniform("transparency", mesh.transparency);
-            mesh()->render(mainShader);
+            frame.models[i] = { model().get(), Instance{ transformMatrix, normalMatrix, model.transparency } };
+            modelSpheres[i] = modelCulling.getSphere(visibleModels[i]);
+        }
+    });
+
+    auto meshes = registry.view<const TransformComponent, const MeshComponent>();
+    for (auto [entity, current, mesh] : meshes.each()) {
+        if (gpuCuller && registry.try_get<StaticComponent>(entity))
+            continue;
+
+        auto transform = interpolated(entity, current);
+        auto sphere = transform.transformSphere(mesh()->getBounds().sphere);
+
+        if (!frustum.checkSphere(glm::vec3{ sphere }, sphere.w))
+            continue;
+
+        if (occlusionCulling && !occlusionCuller.isVisible(glm::vec3{ sphere }, sphere.w)) {
+            occludedCount++;
+            continue;
         }
+
+        glm::mat4 transformMatrix{ transform };
+        glm::mat3 normalMatrix{ glm::transpose(glm::inverse(glm::mat3{ transformMatrix })) };
+
+        frame.meshes.emplace_back(mesh().get(), Instance{ transformMatrix, normalMatrix, mesh.transparency });
+        meshSpheres.push_back(sphere);
     }
 
     auto& m = registry.get<ModelComponent>(spaceship);
-    auto& t = registry.get<TransformComponent>(spaceship);
+    auto t = interpolated(spaceship, registry.get<TransformComponent>(spaceship));
     auto& s = registry.get<ShipComponent>(spaceship);
 
-    if (frustum.checkSphere(t.translation, m.radius * glm::max(t.scale.x, t.scale.y, t.scale.z))) {
-        glm::mat4 transformMatrix{ t };
-        transformMatrix = glm::translate(transformMatrix, {s.shift, 0});
+    glm::mat4 shipMatrix{ t };
+    shipMatrix = glm::translate(shipMatrix, {s.shift, 0});
 
-        glm::mat3 normalMatrix{ glm::transpose(glm::inverse(glm::mat3{ transformMatrix })) };
+    // The ship's parts are culled one by one
+    auto shipSphere = m()->getBounds().getSphere(shipMatrix);
+    if (frustum.checkSphere(glm::vec3{ shipSphere }, shipSphere.w)) {
+        glm::mat3 normalMatrix{ glm::transpose(glm::inverse(glm::mat3{ shipMatrix })) };
 
-        mainShader->setUniform("u_transform", transformMatrix);
-        mainShader->setUniform("u_normal", normalMatrix);
-        mainShader->setUniform("transparency", 1.0f);
-        m()->render(mainShader);
+        for (const auto& mesh : m()->getMeshes()) {
+            auto sphere = mesh->getBounds().getSphere(shipMatrix);
+            if (frustum.checkSphere(glm::vec3{ sphere }, sphere.w)) {
+                frame.meshes.emplace_back(mesh.get(), Instance{ shipMatrix, normalMatrix, 1.0f });
+                meshSpheres.push_back(sphere);
+            }
+        }
     }
 
-    mainShader->setUniform("lighting_on", false);
-
-    uint32_t i = 0;
     auto spotLights = registry.view<const SpotLight>();
-    mainShader->setUniform("gNumSpotLights", static_cast<int>(spotLights.size()));
+    for (auto [entity, light] : spotLights.each())
+        frame.spotLights.push_back(light);
 
-    for (auto [entity, light] : spotLights.each()) {
-        light.submit(mainShader, i);
-        i++;
+    auto pointLights = registry.view<const PointLight>();
+    for (auto [entity, light] : pointLights.each())
+        frame.pointLights.push_back(light);
+
+    if (objectLights)
+        assignObjectLights(frame);
+
+    frame.print(*font, "Press TAB to lock mouse and use camera", 20, 20);
+    frame.print(*font, "Press ESC to exit", 20, 50);
+    frame.print(*font, "Press F1 to enable wiremode renderer", 20, 80);
+    frame.print(*font, "Press F2 to toggle lighting", 20, 110);
+    frame.print(*font, "Press F3 to switch view mode", 20, 140);
+    frame.print(*font, "Press F4 to show the profiler, F5 to record a trace", 20, 170);
+    frame.print(*font, glm::to_string(frame.eye), window.getWidth() / 2, window.getHeight() - 30);
+    frame.print(*font, "Time: " + std::to_string(glfwGetTime()), window.getWidth() / 2 + 150.0f, 20);
+    if (occlusionCulling) {
+        frame.print(*font, "Occlusion: " + std::to_string(occluders.size()) + " occluders, " + std::to_string(occlusionCuller.getPartCount())
+            + " parts, " + std::to_string(occludedCount) + " hidden", 20, window.getHeight() - 180);
     }
 
-    i = 0;
-    auto pointLights = registry.view<const PointLight>();
-    mainShader->setUniform("gNumPointLights", static_cast<int>(pointLights.size()));
+    displayFrameRate(frame);
 
-    for (auto [entity, light] : pointLights.each()) {
-        light.submit(mainShader, i);
-        i++;
+    if (showProfiler)
+        displayProfiler(frame);
+
+    // Icons
+    frame.print(*icons, "abcdefghijkl", 20, window.getHeight() / 2, 1, { 1, 0, 0, 1 });
+    frame.print(*icons, "mnopqrstuvwxyz", 20, window.getHeight() / 2 - 30, 1, { 0, 1, 0, 1 });
+    frame.print(*icons, "ABCDEFGHIJKLMN\nOPQRSTUVWXYZ", 20, window.getHeight() / 2 - 60, 1, { 0, 0, 1, 1 });
+}
+
+// Rasterize the occluders largest on screen and drop the frustum visible models hidden behind them
+void Game::cullOccluded(const RenderSnapshot& frame) {
+    PROFILE_SCOPE("occlusion");
+
+    constexpr size_t MaxOccluders = 32;
+    constexpr float MinOccluderSize = 0.02f; // radius over distance, smaller ones hide too little to be worth drawing
+
+    // The ship is drawn shifted off its path
+    auto placement = [&](entt::entity entity) {
+        glm::mat4 matrix{ interpolated(entity, registry.get<TransformComponent>(entity)) };
+        if (auto ship = registry.try_get<ShipComponent>(entity))
+            matrix = glm::translate(matrix, { ship->shift, 0 });
+        return matrix;
+    };
+
+    occluders.clear();
+    auto view = registry.view<const TransformComponent, const OccluderComponent>();
+    for (auto [entity, current, occluder] : view.each()) {
+        auto transform = interpolated(entity, current);
+        glm::vec3 center{ placement(entity)[3] };
+        float radius = occluder.radius * glm::max(transform.scale.x, transform.scale.y, transform.scale.z);
+        float size = radius / std::max(glm::distance(center, frame.eye), radius);
+        if (size > MinOccluderSize && frustum.checkSphere(center, radius))
+            occluders.emplace_back(-size, entity);
     }
 
-    mainShader->setUniform("lighting_on", true);
+    auto count = std::min(occluders.size(), MaxOccluders);
+    std::partial_sort(occluders.begin(), occluders.begin() + count, occluders.end());
+    occluders.resize(count);
+
+    occlusionCuller.begin(frame.projection * frame.view);
+    for (const auto& [size, entity] : occluders)
+        occlusionCuller.add(*registry.get<OccluderComponent>(entity).occluder, placement(entity));
+    occlusionCuller.rasterize();
+
+    // Tested on the workers, compacted in order afterwards
+    occludedModels.resize(visibleModels.size());
+    JobSystem::ParallelFor(0, static_cast<uint32_t>(visibleModels.size()), 256, [&](uint32_t first, uint32_t last) {
+        for (uint32_t i = first; i < last; i++) {
+            auto sphere = modelCulling.getSphere(visibleModels[i]);
+            occludedModels[i] = !occlusionCuller.isVisible(glm::vec3{ sphere }, sphere.w);
+        }
+    });
 
-    //////////////////////////////////////////////////////////////
+    size_t kept = 0;
+    for (size_t i = 0; i < visibleModels.size(); i++) {
+        if (!occludedModels[i])
+            visibleModels[kept++] = visibleModels[i];
+    }
+    occludedCount = static_cast<uint32_t>(visibleModels.size() - kept);
+    visibleModels.resize(kept);
+}
+
+// Give every visible instance the list of lights that reach its bounding sphere
+void Game::assignObjectLights(RenderSnapshot& frame) {
+    PROFILE_SCOPE("object lights");
+
+    lightGrid.build(frame.pointLights, frame.spotLights);
+
+    // Fixed chunks gather into their own lists on the workers, concatenated in order afterwards
+    auto gather = [&](auto& objects, const std::vector<glm::vec4>& spheres) {
+        constexpr uint32_t Grain = 64;
+        auto chunks = static_cast<uint32_t>((objects.size() + Grain - 1) / Grain);
+        if (lightChunks.size() < chunks)
+            lightChunks.resize(chunks);
+
+        JobSystem::ParallelFor(0, chunks, 1, [&](uint32_t first, uint32_t last) {
+            for (uint32_t chunk = first; chunk < last; chunk++) {
+                auto& indices = lightChunks[chunk];
+                indices.clear();
+                for (size_t i = chunk * Grain; i < std::min<size_t>(objects.size(), (chunk + 1) * Grain); i++) {
+                    auto& instance = objects[i].second;
+                    auto start = static_cast<uint32_t>(indices.size());
+                    lightGrid.query(glm::vec3{ spheres[i] }, spheres[i].w, indices);
+                    instance.lights = { start, static_cast<uint32_t>(indices.size()) - start };
+                }
+            }
+        });
 
-    skyboxShader->use();
-    skyboxShader->setUniform("u_view_projection", projMatrix * glm::mat4{glm::mat3{viewMatrix}}); // remove translation from the view matrix
-    skyboxShader->setUniform("skybox", 0);
+        for (uint32_t chunk = 0; chunk < chunks; chunk++) {
+            auto base = static_cast<uint32_t>(frame.objectLights.size());
+            for (size_t i = chunk * Grain; i < std::min<size_t>(objects.size(), (chunk + 1) * Grain); i++)
+                objects[i].second.lights.x += base;
+            frame.objectLights.insert(frame.objectLights.end(), lightChunks[chunk].begin(), lightChunks[chunk].end());
+        }
+    };
 
-    skybox->render();
+    gather(frame.models, modelSpheres);
+    gather(frame.meshes, meshSpheres);
+}
 
-    //////////////////////////////////////////////////////////////
+// Render method draws one snapshot, it owns the GL context and may run on its own thread
+void Game::render(const RenderSnapshot& frame) {
+    PROFILE_SCOPE("render");
+    PROFILE_GPU_SCOPE("frame");
 
-    /*splineShader->use();
-    splineShader->setUniform("u_view_projection", viewProjMatrix);
+    if (framebuffer)
+        framebuffer->bind();
 
-    tubeMesh->render();*/
+    // Edited shaders start building now, whatever finished linking since the last frame is swapped in
+    if (shaderWatcher) {
+        for (const auto& file : shaderWatcher->poll())
+            Shader::Reload(file);
+    }
+    Shader::Update();
+
+    glCall(glViewport, 0, 0, frame.size.x, frame.size.y);
+    GLState::PolygonMode(frame.wireframe ? GL_LINE : GL_FILL);
+
+    // Clear the buffers and enable depth testing (z-buffering)
+    glCall(glClear, GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    GLState::Enable(GL_DEPTH_TEST);
+
+    auto viewProjMatrix = frame.projection * frame.view;
+
+    // Lighting and fog are compiled into the program, the variants used this frame get the per-frame uniforms on first use
+    uint32_t features = FeatureLighting | (frame.darkMode ? FeatureFog : 0);
+    mainShaders->beginFrame([viewProjMatrix, eye = frame.eye](Shader& shader, uint32_t variant) {
+        shader.setUniform("u_view_projection", viewProjMatrix);
+        if (variant & FeatureLighting)
+            shader.setUniform("gEyeWorldPos", eye);
+    });
+    directionalLight.ambientIntensity = frame.darkMode ? 0.15f : 1.0f;
+    directionalLight.diffuseIntensity = frame.darkMode ? 0.1f : 1.0f;
+
+    // All lights go into one storage block, only the ones that changed since the last frame are uploaded
+    lightBuffer->update(directionalLight, frame.pointLights, frame.spotLights);
+    lightBuffer->bind();
+
+    // Each fragment only shades the lights listed for its cluster, the flat loop is the fallback
+    if (lightClusters && lightClusters->update(frame.view, frame.projection, frame.size, frame.pointLights, frame.spotLights)) {
+        lightClusters->bind();
+        features |= FeatureClustered;
+    }
+
+    // Queued instances carry their own light lists, the compute culled statics keep using the clusters
+    uint32_t queuedFeatures = features;
+    if (objectLights && LightBuffer::BindObjectLights(*streamBuffer, frame.objectLights))
+        queuedFeatures = (features & ~FeatureClustered) | FeatureObjectLights;
+
+    // Render scene
+    {
+        PROFILE_SCOPE("scene");
+        PROFILE_GPU_SCOPE("scene");
+
+        renderQueue->begin(frame.eye, 5000.0f);
+
+        for (const auto& [model, instance] : frame.models)
+            renderQueue->submit(*mainShaders, queuedFeatures, model, instance);
+
+        for (const auto& [mesh, instance] : frame.meshes)
+            renderQueue->submit(*mainShaders, queuedFeatures, mesh, instance);
+
+        renderQueue->renderOpaque();
+    }
+
+    // The compute culled statics are opaque, they have to be in the depth buffer before anything blends over them
+    if (gpuCuller) {
+        PROFILE_SCOPE("gpu culling");
+        PROFILE_GPU_SCOPE("gpu culling");
+
+        gpuCuller->cull(frame.frustum);
+        gpuCuller->render(*mainShaders, features);
+
+        if (validateCulling)
+            gpuCuller->validate(frame.frustum);
+    }
+
+    {
+        PROFILE_SCOPE("translucent");
+        PROFILE_GPU_SCOPE("translucent");
+
+        renderQueue->renderTranslucent();
+    }
 
     //////////////////////////////////////////////////////////////
 
-    // Disable depth and enable blend for text rendering
-    glCall(glDisable, GL_DEPTH_TEST);
+    if (skyboxShader->isReady()) {
+        PROFILE_GPU_SCOPE("skybox");
 
-    textShader->use();
-    textShader->setUniform("u_projection", camera.getOrthographicProjectionMatrix());
-    textShader->setUniform("color", glm::vec4{1});
-    textShader->setUniform("atlas", 0);
+        skyboxShader->use();
+        skyboxShader->setUniform("u_view_projection", frame.projection * glm::mat4{glm::mat3{frame.view}}); // remove translation from the view matrix
+        skyboxShader->setUniform("skybox", 0);
 
-    font->bind();
+        skybox->render();
+    }
 
-    textMesh->render(font, "Press TAB to lock mouse and use camera", 20, 20, 1);
-    textMesh->render(font, "Press ESC to exit", 20, 50, 1);
-    textMesh->render(font, "Press F1 to enable wiremode renderer", 20, 80, 1);
-    textMesh->render(font, "Press F2 to toggle lighting", 20, 110, 1);
-    textMesh->render(font, "Press F3 to switch view mode", 20, 140, 1);
-    textMesh->render(font, glm::to_string(camera.getPosition()), window.getWidth() / 2, window.getHeight() - 30, 1);
-    textMesh->render(font, "Time: " + std::to_string(glfwGetTime()), window.getWidth() / 2 + 150.0f, 20, 1);
+    //////////////////////////////////////////////////////////////
 
-	// Draw the 2D graphics after the 3D graphics
-	displayFrameRate();
+    /*splineShader->use();
+    splineShader->setUniform("u_view_projection", viewProjMatrix);
 
-    // Draw icons
+    tubeMesh->render();*/
 
-    icons->bind();
+    //////////////////////////////////////////////////////////////
 
-    textShader->setUniform("color", glm::vec4{1, 0, 0, 1});
+    // Disable depth and enable blend for text rendering
+    PROFILE_GPU_SCOPE("text");
+    GLState::Disable(GL_DEPTH_TEST);
 
-    textMesh->render(icons, "abcdefghijkl", 20, window.getHeight() / 2, 1);
+    if (!textShader->isReady())
+        return;
 
-    textShader->setUniform("color", glm::vec4{0, 1, 0, 1});
+    textShader->use();
+    textShader->setUniform("u_projection", frame.orthographic);
+    textShader->setUniform("atlas", 0);
 
-    textMesh->render(icons, "mnopqrstuvwxyz", 20, window.getHeight() / 2 - 30, 1);
+    const Font* boundFont = nullptr;
+    glm::vec4 boundColor{ -1.0f };
 
-    textShader->setUniform("color", glm::vec4{0, 0, 1, 1});
+    for (const auto& text : frame.texts) {
+        if (text.font != boundFont) {
+            text.font->bind();
+            boundFont = text.font;
+        }
+        if (text.color != boundColor) {
+            textShader->setUniform("color", text.color);
+            boundColor = text.color;
+        }
+        textMesh->render(*text.font, text.text, text.position.x, text.position.y, text.scale);
+    }
 
-    textMesh->render(icons, "ABCDEFGHIJKLMN\nOPQRSTUVWXYZ", 20, window.getHeight() / 2 - 60, 1);
+    // Render stats are only known on this side
+    font->bind();
+    textShader->setUniform("color", glm::vec4{1});
+    displayRenderStats(frame);
 }
 
 // Update method runs repeatedly with the Render method
@@ -336,15 +721,74 @@ void Game::update() {
     if (Input::GetKeyDown(GLFW_KEY_F3))
         viewMode = viewMode + 1 % 4;
 
-    moveShip();
-    blinkEffect();
+    if (Input::GetKeyDown(GLFW_KEY_F4))
+        showProfiler = !showProfiler;
+
+    if (Input::GetKeyDown(GLFW_KEY_F5)) {
+        if (Profiler::IsCapturing())
+            Profiler::EndCapture("trace_" + std::to_string(frameNumber) + ".json");
+        else
+            Profiler::BeginCapture();
+    }
+
+    // Mouse deltas are per frame, so looking around isn't stepped
+    camera.setViewByMouse();
+}
+
+// Simulation systems only ever see the fixed step
+void Game::simulate(float step) {
+    PROFILE_SCOPE("simulate");
+
+    auto movers = registry.view<const TransformComponent, InterpolationComponent>();
+    for (auto [entity, transform, interpolation] : movers.each())
+        interpolation.previous = transform;
+    camera.storePose();
+
+    moveShip(step);
+    blinkEffect(step);
+
+    if (benchmark)
+        flyPath(step);
 
     if (window.Locked()) {
-        camera.update(dt);
+        camera.translateByKeyboard(step);
     }
 }
 
-void Game::displayFrameRate() {
+// Run per frame work, then catch the simulation up with the frame time in fixed steps
+void Game::advance() {
+    PROFILE_SCOPE("update");
+
+    update();
+
+    float step = 1.0f / tickRate;
+    accumulator += dt;
+
+    uint32_t steps = 0;
+    while (accumulator >= step && steps < maxCatchUpSteps) {
+        simulate(step);
+        accumulator -= step;
+        steps++;
+    }
+
+    // Drop what can't be caught up on instead of spiralling on long frames
+    if (accumulator >= step)
+        accumulator = std::fmod(accumulator, step);
+
+    alpha = accumulator / step;
+}
+
+TransformComponent Game::interpolated(entt::entity entity, const TransformComponent& transform) const {
+    if (auto interpolation = registry.try_get<InterpolationComponent>(entity))
+        return TransformComponent::Lerp(interpolation->previous, transform, alpha);
+    return transform;
+}
+
+void Game::invalidateModelBounds(entt::registry&, entt::entity) {
+    modelBoundsDirty = true;
+}
+
+void Game::displayFrameRate(RenderSnapshot& frame) {
     // Increase the elapsed time and frame counter
     frameNumber++;
     elapsedTime += dt;
@@ -361,11 +805,49 @@ void Game::displayFrameRate() {
     }
 
     if (framesPerSecond > 0) {
-        textMesh->render(font, "FPS: " + std::to_string(framesPerSecond), 20, window.getHeight() - 30, 1.0f);
+        frame.print(*font, "FPS: " + std::to_string(framesPerSecond), 20, window.getHeight() - 30);
+    }
+}
+
+void Game::displayProfiler(RenderSnapshot& frame) {
+    float x = window.getWidth() - 600.0f;
+    float y = window.getHeight() - 30.0f;
+
+    frame.print(*font, "Scope (ms): min / avg / p99", x, y);
+
+    char line[128];
+    for (const auto& scope : Profiler::Report()) {
+        y -= 30.0f;
+        std::snprintf(line, sizeof(line), "%s %.*s: %.2f / %.2f / %.2f", scope.gpu ? "GPU" : "CPU",
+                      static_cast<int>(scope.name.size()), scope.name.data(), scope.min, scope.avg, scope.p99);
+        frame.print(*font, line, x, y, 1, scope.gpu ? glm::vec4{ 0.5f, 1, 0.5f, 1 } : glm::vec4{ 1 });
     }
 }
 
-void Game::moveShip() {
+void Game::displayRenderStats(const RenderSnapshot& frame) {
+    const auto& stats = renderQueue->getStats();
+    textMesh->render(*font, "Draws: " + std::to_string(stats.drawCalls) + " (" + std::to_string(stats.indirectDraws) + " indirect) / " + std::to_string(stats.packets) + " packets", 20, frame.size.y - 60, 1.0f);
+    textMesh->render(*font, "Skipped binds: " + std::to_string(stats.programBindsSkipped) + " program, "
+        + std::to_string(stats.vaoBindsSkipped) + " vao, "
+        + std::to_string(stats.textureBindsSkipped) + " texture, " + std::to_string(GLState::GetSkipped()) + " redundant state", 20, frame.size.y - 90, 1.0f);
+
+    std::string lighting = std::to_string(frame.pointLights.size() + frame.spotLights.size()) + " lights";
+    if (objectLights)
+        lighting += ", " + std::to_string(frame.objectLights.size()) + " object references";
+    if (lightClusters)
+        lighting += ", " + std::to_string(lightClusters->getReferenceCount()) + " cluster references (up to " + std::to_string(lightClusters->getMaxPerCluster()) + " per cluster)";
+    textMesh->render(*font, "Lighting: " + lighting, 20, frame.size.y - 120, 1.0f);
+
+    if constexpr (GLStats::Enabled) {
+        const auto& gl = GLStats::GetLastFrame();
+        textMesh->render(*font, "GL calls: " + std::to_string(gl.calls) + ", " + std::to_string(gl.drawCalls) + " draws, "
+            + std::to_string(gl.programBinds) + " program / " + std::to_string(gl.vaoBinds) + " vao / "
+            + std::to_string(gl.textureBinds) + " texture binds, " + std::to_string(gl.uniformUploads) + " uniforms, "
+            + std::to_string((gl.bufferBytes + gl.textureBytes) / 1024) + " KB uploaded", 20, frame.size.y - 150, 1.0f);
+    }
+}
+
+void Game::moveShip(float step) {
     auto& transform = registry.get<TransformComponent>(spaceship);
     auto& ship = registry.get<ShipComponent>(spaceship);
     auto& spotLight= registry.get<SpotLight>(spaceship);
@@ -386,15 +868,15 @@ void Game::moveShip() {
     }
 
     if (Input::GetKey(GLFW_KEY_UP))
-        ship.shift += vec2::up * ship.speed * dt;
+        ship.shift += vec2::up * ship.speed * step;
     if (Input::GetKey(GLFW_KEY_DOWN))
-        ship.shift -= vec2::up * ship.speed * dt;
+        ship.shift -= vec2::up * ship.speed * step;
     if (Input::GetKey(GLFW_KEY_RIGHT))
-        ship.shift += vec2::right * ship.speed * dt;
+        ship.shift += vec2::right * ship.speed * step;
     if (Input::GetKey(GLFW_KEY_LEFT))
-        ship.shift -= vec2::right * ship.speed * dt;
+        ship.shift -= vec2::right * ship.speed * step;
 
-    transform.translation = glm::smoothDamp(current, target, ship.velocity, 0.01f, ship.maxSpeed, dt);
+    transform.translation = glm::smoothDamp(current, target, ship.velocity, 0.01f, ship.maxSpeed, step);
     transform.rotation = glm::quatLookAt(direction, vec3::up);
 
     // Modify children
@@ -431,10 +913,25 @@ void Game::moveShip() {
     }
 }
 
-void Game::blinkEffect() {
+// Benchmarks fly the camera along the centreline at a constant rate so every run sees the same frames
+void Game::flyPath(float step) {
+    auto& points = catmullRom.getCentrelinePoints();
+    auto& normals = catmullRom.getCentrelineNormals();
+
+    pathPosition = std::fmod(pathPosition + pathSpeed * step, static_cast<float>(points.size()));
+
+    auto i = static_cast<size_t>(pathPosition);
+    auto j = (i + 1) % points.size();
+    float t = pathPosition - static_cast<float>(i);
+
+    camera.setPosition(glm::mix(points[i], points[j], t) + vec3::up * 5.0f);
+    camera.setRotation(glm::quatLookAt(glm::normalize(glm::mix(normals[i], normals[j], t)), vec3::up));
+}
+
+void Game::blinkEffect(float step) {
     auto meshes = registry.view<MeshComponent, BlinkComponent>();
     for (auto [entity, mesh] : meshes.each()) {
-        mesh.transparency += 0.01;
+        mesh.transparency += blinkRate * step;
         if (mesh.transparency > 1.0f)
             mesh.transparency = 0;
     }
@@ -442,37 +939,130 @@ void Game::blinkEffect() {
 
 // The game loop runs repeatedly until game over
 void Game::run() {
+    double start = glfwGetTime();
+    lastPresent = start;
+
+    if (pipelined) {
+        runPipelined();
+    } else {
+        runSerial();
+    }
+
+    if (!tracePath.empty())
+        Profiler::EndCapture(tracePath);
+
+    double elapsed = glfwGetTime() - start;
+    std::cout << "Rendered " << presentedFrames << " frames in " << elapsed << "s, "
+              << elapsed * 1000.0 / static_cast<double>(std::max<uint64_t>(presentedFrames, 1)) << " ms per frame" << std::endl;
+}
+
+// Finish a drawn frame on the GL thread
+void Game::present() {
+    PROFILE_SCOPE("present");
+
+    Profiler::EndGpuFrame();
+    GLStats::EndFrame();
+    GLState::EndFrame();
+    presentedFrames++;
+
+    double now = glfwGetTime();
+    if (onPresent)
+        onPresent(now - lastPresent, renderQueue->getStats());
+    lastPresent = now;
+
+    if (framebuffer && !dumpPath.empty()) {
+        std::string name = std::to_string(presentedFrames);
+        framebuffer->save(dumpPath / ("frame_" + std::string(6 - std::min<size_t>(name.size(), 6), '0') + name + ".png"));
+    }
+
+    if (!window.isHeadless())
+        window.swapBuffers();
+}
+
+void Game::runSerial() {
+    RenderSnapshot frame;
+
     float currentTime = static_cast<float>(glfwGetTime());
     float previousTime = currentTime;
 
     while (!window.shouldClose()) {
         currentTime = static_cast<float>(glfwGetTime());
-        dt = currentTime - previousTime;
+        dt = benchmark ? 1.0f / tickRate : currentTime - previousTime;
         previousTime = currentTime;
 
-        update();
-        render();
+        advance();
+
+        frame.clear();
+        snapshot(frame);
+
+        streamBuffer->beginFrame();
+        render(frame);
+        streamBuffer->endFrame();
 
         Input::Update();
 
-        window.swapBuffers();
+        present();
         window.pollEvents();
+
+        if (frameLimit != 0 && frameNumber >= frameLimit)
+            window.shouldClose(true);
     }
 }
 
+// Simulation stays on the main thread, which has to poll GLFW events, and the context moves to a render thread
+// that draws the previous snapshot while the next one is simulated
+void Game::runPipelined() {
+    SnapshotQueue snapshots{ pipelineDepth };
+
+    window.releaseCurrent();
+
+    std::thread renderThread{ [this, &snapshots] {
+        Profiler::SetThreadName("render");
+        window.makeCurrent();
+
+        while (auto* frame = snapshots.consume()) {
+            streamBuffer->beginFrame();
+            render(*frame);
+            streamBuffer->endFrame();
+
+            present();
+            snapshots.release(frame);
+        }
+
+        window.releaseCurrent();
+    } };
+
+    float currentTime = static_cast<float>(glfwGetTime());
+    float previousTime = currentTime;
+
+    while (!window.shouldClose()) {
+        currentTime = static_cast<float>(glfwGetTime());
+        dt = benchmark ? 1.0f / tickRate : currentTime - previousTime;
+        previousTime = currentTime;
+
+        advance();
+
+        if (auto* frame = snapshots.acquire()) {
+            snapshot(*frame);
+            snapshots.submit(frame);
+        }
+
+        Input::Update();
+
+        window.pollEvents();
+
+        if (frameLimit != 0 && frameNumber >= frameLimit)
+            window.shouldClose(true);
+    }
+
+    snapshots.close();
+    renderThread.join();
+
+    // Resources are released on the main thread
+    window.makeCurrent();
+}
+
 Game& Game::getInstance() {
     static Game instance;
     return instance;
 }
-
-int main(int args, char** argv) {
-    Game& game = Game::getInstance();
-    try {
-        game.init();
-        game.run();
-    } catch (const std::exception& e) {
-        std::cerr << e.what() << std::endl;
-        return EXIT_FAILURE;
-    }
-    return EXIT_SUCCESS;
-}
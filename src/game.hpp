@@ -7,18 +7,34 @@
 // Game includes
 #include "camera.hpp"
 #include "shader.hpp"
+#include "shadervariants.hpp"
 #include "model.hpp"
 #include "mesh.hpp"
 #include "lights.hpp"
+#include "lightbuffer.hpp"
+#include "lightgrid.hpp"
 #include "textmesh.hpp"
 #include "skybox.hpp"
 #include "catmullrom.hpp"
 #include "frustum.hpp"
+#include "cullingsystem.hpp"
+#include "bvh.hpp"
+#include "occlusionculler.hpp"
+#include "renderqueue.hpp"
+#include "streambuffer.hpp"
+#include "geometryarena.hpp"
+#include "gpuculler.hpp"
+#include "rendersnapshot.hpp"
+#include "components.hpp"
 
 #include <entt/entity/registry.hpp>
 
 int main(int argc, char** argv);
 
+class Framebuffer;
+class FileWatcher;
+class LightClusters;
+
 // Classes used in game.  For a new class, declare it here and provide a pointer to an object of this class below.  Then, in Game.cpp, 
 // include the header.  In the Game constructor, set the pointer to nullptr and in Game::Initialise, create a new object.  Don't forget to
 // delete the object in the destructor.   
@@ -30,40 +46,118 @@ private:
 
 	void init();
     void run();
+    void runSerial();
+    void runPipelined();
+    void present();
     void update();
-    void render();
+    void simulate(float step);
+    void advance();
+    void snapshot(RenderSnapshot& frame);
+    void cullOccluded(const RenderSnapshot& frame);
+    void assignObjectLights(RenderSnapshot& frame);
+    void render(const RenderSnapshot& frame);
+
+    static inline glm::ivec2 resolution{ 1280, 720 }; // read when the window is created
+    static inline Window::Backend backend{ Window::Backend::Native };
 
     Window window;
+    std::unique_ptr<Framebuffer> framebuffer; // headless only
+#ifndef NDEBUG
+    GLDebug::Mode glDebugMode{ GLDebug::Mode::Sync };
+#else
+    GLDebug::Mode glDebugMode{ GLDebug::Mode::Off };
+#endif
+    uint64_t frameLimit{ 0 }; // close after this many frames, 0 runs until the window is closed
+    uint64_t presentedFrames{ 0 };
+    std::filesystem::path dumpPath; // write every presented frame as PNG, needs an offscreen framebuffer
     uint64_t frameNumber{ 0 };
     uint32_t frameCount{ 0 };
     uint32_t framesPerSecond{ 0 };
     float elapsedTime{ 0.0 };
     float dt{ 0.0 };
 
+    float tickRate{ 60.0f }; // fixed simulation steps per second
+    uint32_t maxCatchUpSteps{ 5 }; // per frame, older simulation time is dropped
+    float accumulator{ 0.0f };
+    float alpha{ 0.0f }; // how far the rendered frame is between the last two steps
+    float blinkRate{ 0.6f }; // transparency per second
+
+    bool mergeGeometry{ false }; // opt-in: suballocate all static meshes from one arena and draw them indirectly
+    std::unique_ptr<GeometryArena> geometryArena;
+    bool gpuCulling{ false }; // opt-in: cull static entities in a compute shader, implies mergeGeometry
+    bool validateCulling{ false };
+    std::unique_ptr<GpuCuller> gpuCuller;
+    bool pipelined{ false }; // opt-in: simulate the next frame while a render thread draws the previous one
+    uint32_t pipelineDepth{ 1 }; // snapshots the simulation may run ahead, trades latency for throughput
+    bool clusteredLighting{ true }; // off shades every light for every fragment
+    bool objectLights{ true }; // queued draws only shade the lights reaching their bounding sphere, before clusters
+    bool bvhCulling{ true }; // off tests every model's sphere against the frustum each frame
+    bool occlusionCulling{ true }; // off draws everything inside the frustum, hidden or not
+    bool hotReload{ false }; // opt-in: rebuild shaders in the background when their files change
+    std::unique_ptr<FileWatcher> shaderWatcher;
+
     entt::registry registry;
     entt::entity spaceship;
 
     Camera camera;
 	Frustum frustum;
+    CullingSystem modelCulling; // one sphere per entity of the model group, by slot
+    Bvh modelBvh; // over the same slots
+    std::vector<entt::entity> modelEntities; // entity of each slot
+    std::vector<uint32_t> movingModels; // slots without a StaticComponent, refreshed every frame
+    std::vector<uint32_t> visibleModels;
+    bool modelBoundsDirty{ true }; // the model group changed, every slot is rewritten
+    OcclusionCuller occlusionCuller;
+    std::vector<std::pair<float, entt::entity>> occluders; // of the frame, largest on screen first
+    std::vector<uint8_t> occludedModels; // by index into visibleModels
+    uint32_t occludedCount{ 0 };
 	CatmullRom catmullRom;
 
 	DirectionalLight directionalLight;
+    std::unique_ptr<StreamBuffer> streamBuffer;
+    std::unique_ptr<LightBuffer> lightBuffer;
+    std::unique_ptr<LightClusters> lightClusters;
+    LightGrid lightGrid;
+    std::vector<glm::vec4> modelSpheres; // bounds of frame.models and frame.meshes while snapshotting
+    std::vector<glm::vec4> meshSpheres;
+    std::vector<std::vector<uint32_t>> lightChunks;
     std::unique_ptr<Skybox> skybox;
     std::unique_ptr<TextMesh> textMesh;
 	std::unique_ptr<Font> font;
 	std::unique_ptr<Font> icons;
 
-    std::unique_ptr<Shader> mainShader;
+    std::unique_ptr<ShaderVariants> mainShaders;
     std::unique_ptr<Shader> skyboxShader;
     std::unique_ptr<Shader> textShader;
     std::unique_ptr<Shader> splineShader;
 
+    std::unique_ptr<RenderQueue> renderQueue;
+
+    // Scene size, the benchmark scales these up
+    int asteroidCount{ -1 }; // -1 fills the field with Poisson disk samples
+    int torusCount{ -1 }; // -1 places one every 30 centreline points
+    uint32_t pointLightCount{ 0 }; // extra lights along the path
+    uint32_t spotLightCount{ 0 };
+
+    bool benchmark{ false }; // the camera flies the path and every frame advances exactly one step
+    float pathPosition{ 0.0f };
+    float pathSpeed{ 60.0f }; // centreline points per second
+    double lastPresent{ 0.0 };
+    std::function<void(double frameTime, const RenderQueue::Stats& stats)> onPresent; // on the GL thread
+
     bool darkMode{ true };
     int viewMode{ 0 };
-
-	void displayFrameRate();
-	void moveShip();
-    void blinkEffect();
+    bool showProfiler{ false };
+    std::filesystem::path tracePath; // capture the whole run into this Chrome trace
+
+	void displayFrameRate(RenderSnapshot& frame);
+	void displayRenderStats(const RenderSnapshot& frame);
+	void displayProfiler(RenderSnapshot& frame);
+	void moveShip(float step);
+    void blinkEffect(float step);
+    void flyPath(float step);
+    TransformComponent interpolated(entt::entity entity, const TransformComponent& transform) const;
+    void invalidateModelBounds(entt::registry& registry, entt::entity entity);
 
     friend int ::main(int argc, char** argv);
 
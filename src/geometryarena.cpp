@@ -0,0 +1,118 @@
+#include "geometryarena.hpp"
+#include "mesh.hpp"
+#include "opengl.hpp"
+#include "glstate.hpp"
+
+GeometryArena* GeometryArena::instance;
+
+GeometryArena::GeometryArena(size_t vertexCapacity, size_t indexCapacity)
+    : vertexCapacity{vertexCapacity}
+    , indexCapacity{indexCapacity}
+{
+    assert(instance == nullptr && "Only one geometry arena can exist!");
+    instance = this;
+
+    glCall(glGenBuffers, 1, &vbo);
+    GLState::BindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+    glCall(glBufferData, GL_COPY_WRITE_BUFFER, vertexCapacity * sizeof(Vertex), (GLvoid*) nullptr, GL_STATIC_DRAW);
+
+    glCall(glGenBuffers, 1, &ebo);
+    GLState::BindBuffer(GL_COPY_WRITE_BUFFER, ebo);
+    glCall(glBufferData, GL_COPY_WRITE_BUFFER, indexCapacity * sizeof(GLuint), (GLvoid*) nullptr, GL_STATIC_DRAW);
+    GLState::BindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    glCall(glGenVertexArrays, 1, &vao);
+    GLState::BindVertexArray(vao);
+    Mesh::SetupVertexAttributes();
+
+    glCall(glGenVertexArrays, 1, &instancedVao);
+    GLState::BindVertexArray(instancedVao);
+    Mesh::SetupVertexAttributes();
+    Mesh::SetupInstanceAttributes();
+
+    GLState::BindVertexArray(0);
+
+    attachBuffers();
+}
+
+GeometryArena::~GeometryArena() {
+    GLState::ForgetVertexArray(vao);
+    GLState::ForgetVertexArray(instancedVao);
+    GLState::ForgetBuffer(vbo);
+    GLState::ForgetBuffer(ebo);
+    glCall(glDeleteVertexArrays, 1, &vao);
+    glCall(glDeleteVertexArrays, 1, &instancedVao);
+    glCall(glDeleteBuffers, 1, &vbo);
+    glCall(glDeleteBuffers, 1, &ebo);
+
+    instance = nullptr;
+}
+
+GeometryArena::Range GeometryArena::allocate(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices) {
+    // Non-indexed meshes get a trivial index list, so every arena draw can go through the same indirect path
+    std::vector<GLuint> sequence;
+    if (indices.empty()) {
+        sequence.resize(vertices.size());
+        std::iota(sequence.begin(), sequence.end(), 0);
+    }
+    const auto& elements = indices.empty() ? sequence : indices;
+
+    if (vertexCount + vertices.size() > vertexCapacity || indexCount + elements.size() > indexCapacity) {
+        grow(vertexCount + vertices.size(), indexCount + elements.size());
+    }
+
+    Range range{ static_cast<GLint>(vertexCount), static_cast<GLuint>(indexCount), static_cast<GLsizei>(elements.size()) };
+
+    GLState::BindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+    glCall(glBufferSubData, GL_COPY_WRITE_BUFFER, vertexCount * sizeof(Vertex), vertices.size() * sizeof(Vertex), vertices.data());
+    GLState::BindBuffer(GL_COPY_WRITE_BUFFER, ebo);
+    glCall(glBufferSubData, GL_COPY_WRITE_BUFFER, indexCount * sizeof(GLuint), elements.size() * sizeof(GLuint), elements.data());
+    GLState::BindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    vertexCount += vertices.size();
+    indexCount += elements.size();
+
+    return range;
+}
+
+void GeometryArena::grow(size_t minVertexCapacity, size_t minIndexCapacity) {
+    vertexCapacity = std::max(vertexCapacity * 2, minVertexCapacity);
+    indexCapacity = std::max(indexCapacity * 2, minIndexCapacity);
+
+    // Copy the used part of both buffers into bigger ones, ranges handed out before stay valid
+    GLuint buffers[2];
+    glCall(glGenBuffers, 2, buffers);
+
+    GLState::BindBuffer(GL_COPY_READ_BUFFER, vbo);
+    GLState::BindBuffer(GL_COPY_WRITE_BUFFER, buffers[0]);
+    glCall(glBufferData, GL_COPY_WRITE_BUFFER, vertexCapacity * sizeof(Vertex), (GLvoid*) nullptr, GL_STATIC_DRAW);
+    glCall(glCopyBufferSubData, GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, vertexCount * sizeof(Vertex));
+
+    GLState::BindBuffer(GL_COPY_READ_BUFFER, ebo);
+    GLState::BindBuffer(GL_COPY_WRITE_BUFFER, buffers[1]);
+    glCall(glBufferData, GL_COPY_WRITE_BUFFER, indexCapacity * sizeof(GLuint), (GLvoid*) nullptr, GL_STATIC_DRAW);
+    glCall(glCopyBufferSubData, GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, indexCount * sizeof(GLuint));
+
+    GLState::BindBuffer(GL_COPY_READ_BUFFER, 0);
+    GLState::BindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    GLState::ForgetBuffer(vbo);
+    GLState::ForgetBuffer(ebo);
+    glCall(glDeleteBuffers, 1, &vbo);
+    glCall(glDeleteBuffers, 1, &ebo);
+    vbo = buffers[0];
+    ebo = buffers[1];
+
+    attachBuffers();
+
+    std::cout << "Geometry arena resized to " << vertexCapacity << " vertices, " << indexCapacity << " indices" << std::endl;
+}
+
+void GeometryArena::attachBuffers() const {
+    for (auto id : { vao, instancedVao }) {
+        GLState::BindVertexArray(id);
+        glCall(glBindVertexBuffer, 0, vbo, 0, sizeof(Vertex));
+        glCall(glBindBuffer, GL_ELEMENT_ARRAY_BUFFER, ebo);
+    }
+    GLState::BindVertexArray(0);
+}
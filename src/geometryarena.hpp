@@ -0,0 +1,47 @@
+#pragma once
+
+#include "vertex.hpp"
+
+/// Layout of one command in a GL_DRAW_INDIRECT_BUFFER for glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+/// @brief One large vertex and index buffer shared by all static meshes
+/// While an arena exists, every new Mesh suballocates its geometry here instead of creating its own buffers,
+/// so all of them can be drawn from the same vao and merged into multi-draw-indirect calls.
+/// Allocation is a bump pointer: ranges are never released, the arena is meant for geometry loaded at startup.
+class GeometryArena {
+public:
+    struct Range {
+        GLint baseVertex;
+        GLuint firstIndex;
+        GLsizei count;
+    };
+
+    GeometryArena(size_t vertexCapacity, size_t indexCapacity);
+    ~GeometryArena();
+
+    static GeometryArena* Get() { return instance; }
+
+    Range allocate(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices);
+
+    GLuint getVao() const { return vao; }
+    GLuint getInstancedVao() const { return instancedVao; }
+
+private:
+    GLuint vao, instancedVao, vbo, ebo;
+    size_t vertexCapacity;
+    size_t indexCapacity;
+    size_t vertexCount{ 0 };
+    size_t indexCount{ 0 };
+
+    void grow(size_t minVertexCapacity, size_t minIndexCapacity);
+    void attachBuffers() const;
+
+    static GeometryArena* instance;
+};
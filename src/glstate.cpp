@@ -0,0 +1,236 @@
+#include "glstate.hpp"
+#include "opengl.hpp"
+
+void GLState::UseProgram(GLuint id) {
+    Check("program", GL_CURRENT_PROGRAM, program);
+    if (id == program)
+        return Skip();
+
+    glCall(glUseProgram, id);
+    program = id;
+}
+
+void GLState::BindVertexArray(GLuint vao) {
+    Check("vertex array", GL_VERTEX_ARRAY_BINDING, vertexArray);
+    if (vao == vertexArray)
+        return Skip();
+
+    glCall(glBindVertexArray, vao);
+    vertexArray = vao;
+}
+
+void GLState::BindTexture(GLuint unit, GLenum target, GLuint texture) {
+    assert(unit < MaxTextureUnits);
+
+    int index = TextureTargetIndex(target);
+    if (index < 0) {
+        ActiveTexture(unit);
+        glCall(glBindTexture, target, texture);
+        return;
+    }
+
+#ifndef NDEBUG
+    if (validate) {
+        ActiveTexture(unit);
+        Check("texture", index == Texture2D ? GL_TEXTURE_BINDING_2D : GL_TEXTURE_BINDING_CUBE_MAP, textures[unit][index]);
+    }
+#endif
+
+    if (textures[unit][index] == texture)
+        return Skip();
+
+    ActiveTexture(unit);
+    glCall(glBindTexture, target, texture);
+    textures[unit][index] = texture;
+}
+
+void GLState::BindBuffer(GLenum target, GLuint buffer) {
+    static constexpr GLenum Queries[BufferTargetCount] = {
+        GL_ARRAY_BUFFER_BINDING, GL_COPY_READ_BUFFER_BINDING, GL_COPY_WRITE_BUFFER_BINDING, GL_DRAW_INDIRECT_BUFFER_BINDING,
+        GL_DISPATCH_INDIRECT_BUFFER_BINDING, GL_PIXEL_PACK_BUFFER_BINDING, GL_PIXEL_UNPACK_BUFFER_BINDING
+    };
+
+    int index = BufferTargetIndex(target);
+    if (index < 0) {
+        glCall(glBindBuffer, target, buffer);
+        return;
+    }
+
+    Check("buffer", Queries[index], buffers[index]);
+    if (buffers[index] == buffer)
+        return Skip();
+
+    glCall(glBindBuffer, target, buffer);
+    buffers[index] = buffer;
+}
+
+void GLState::SetCapability(GLenum capability, bool enabled) {
+    int index = CapabilityIndex(capability);
+    if (index < 0) {
+        if (enabled)
+            glCall(glEnable, capability);
+        else
+            glCall(glDisable, capability);
+        return;
+    }
+
+#ifndef NDEBUG
+    if (validate && capabilities[index] >= 0) {
+        bool actual = glCall(glIsEnabled, capability) == GL_TRUE;
+        if (actual != (capabilities[index] == 1)) {
+            std::cerr << "ERROR: GLState capability 0x" << std::hex << capability << std::dec << " is shadowed as " << static_cast<int>(capabilities[index]) << " but GL has " << actual << std::endl;
+            capabilities[index] = -1;
+        }
+    }
+#endif
+
+    if (capabilities[index] == static_cast<int8_t>(enabled))
+        return Skip();
+
+    if (enabled)
+        glCall(glEnable, capability);
+    else
+        glCall(glDisable, capability);
+    capabilities[index] = static_cast<int8_t>(enabled);
+}
+
+void GLState::PolygonMode(GLenum mode) {
+    // Only GL_FRONT_AND_BACK is legal in a core profile, so one value covers both faces
+    Check("polygon mode", GL_POLYGON_MODE, polygonMode);
+    if (mode == polygonMode)
+        return Skip();
+
+    glCall(glPolygonMode, GL_FRONT_AND_BACK, mode);
+    polygonMode = mode;
+}
+
+void GLState::BlendFunc(GLenum source, GLenum destination) {
+    Check("blend source", GL_BLEND_SRC_RGB, blendSource);
+    Check("blend destination", GL_BLEND_DST_RGB, blendDestination);
+    if (source == blendSource && destination == blendDestination)
+        return Skip();
+
+    glCall(glBlendFunc, source, destination);
+    blendSource = source;
+    blendDestination = destination;
+}
+
+void GLState::DepthFunc(GLenum func) {
+    Check("depth func", GL_DEPTH_FUNC, depthFunc);
+    if (func == depthFunc)
+        return Skip();
+
+    glCall(glDepthFunc, func);
+    depthFunc = func;
+}
+
+void GLState::ForgetProgram(GLuint id) {
+    // A deleted program stays in use until something else is bound
+    if (id == program)
+        program = Unknown;
+}
+
+void GLState::ForgetVertexArray(GLuint vao) {
+    if (vao == vertexArray)
+        vertexArray = 0;
+}
+
+void GLState::ForgetTexture(GLuint texture) {
+    for (auto& unit : textures) {
+        for (auto& bound : unit) {
+            if (bound == texture)
+                bound = 0;
+        }
+    }
+}
+
+void GLState::ForgetBuffer(GLuint buffer) {
+    for (auto& bound : buffers) {
+        if (bound == buffer)
+            bound = 0;
+    }
+}
+
+void GLState::Invalidate() {
+    program = Unknown;
+    vertexArray = Unknown;
+    activeUnit = Unknown;
+    for (auto& unit : textures)
+        unit.fill(Unknown);
+    buffers.fill(Unknown);
+    capabilities.fill(-1);
+    polygonMode = Unknown;
+    blendSource = Unknown;
+    blendDestination = Unknown;
+    depthFunc = Unknown;
+}
+
+void GLState::EndFrame() {
+    lastSkipped = skipped;
+    skipped = 0;
+}
+
+int GLState::TextureTargetIndex(GLenum target) {
+    switch (target) {
+        case GL_TEXTURE_2D: return Texture2D;
+        case GL_TEXTURE_CUBE_MAP: return TextureCube;
+        default: return -1;
+    }
+}
+
+int GLState::BufferTargetIndex(GLenum target) {
+    switch (target) {
+        case GL_ARRAY_BUFFER: return ArrayBuffer;
+        case GL_COPY_READ_BUFFER: return CopyRead;
+        case GL_COPY_WRITE_BUFFER: return CopyWrite;
+        case GL_DRAW_INDIRECT_BUFFER: return DrawIndirect;
+        case GL_DISPATCH_INDIRECT_BUFFER: return DispatchIndirect;
+        case GL_PIXEL_PACK_BUFFER: return PixelPack;
+        case GL_PIXEL_UNPACK_BUFFER: return PixelUnpack;
+        default: return -1;
+    }
+}
+
+int GLState::CapabilityIndex(GLenum capability) {
+    switch (capability) {
+        case GL_BLEND: return Blend;
+        case GL_DEPTH_TEST: return DepthTest;
+        case GL_CULL_FACE: return CullFace;
+        case GL_STENCIL_TEST: return StencilTest;
+        case GL_SCISSOR_TEST: return ScissorTest;
+        default: return -1;
+    }
+}
+
+void GLState::ActiveTexture(GLuint unit) {
+#ifndef NDEBUG
+    if (validate && activeUnit != Unknown) {
+        GLint actual;
+        glCall(glGetIntegerv, GL_ACTIVE_TEXTURE, &actual);
+        if (static_cast<GLuint>(actual) != GL_TEXTURE0 + activeUnit) {
+            std::cerr << "ERROR: GLState active texture unit is shadowed as " << activeUnit << " but GL has " << actual - GL_TEXTURE0 << std::endl;
+            activeUnit = Unknown;
+        }
+    }
+#endif
+
+    if (unit == activeUnit)
+        return;
+
+    glCall(glActiveTexture, GL_TEXTURE0 + unit);
+    activeUnit = unit;
+}
+
+void GLState::Check(const char* name, GLenum query, GLuint& shadow) {
+#ifndef NDEBUG
+    if (!validate || shadow == Unknown)
+        return;
+
+    GLint actual[2]{}; // GL_POLYGON_MODE may write front and back
+    glCall(glGetIntegerv, query, actual);
+    if (static_cast<GLuint>(actual[0]) != shadow) {
+        std::cerr << "ERROR: GLState " << name << " is shadowed as " << shadow << " but GL has " << actual[0] << std::endl;
+        shadow = Unknown;
+    }
+#endif
+}
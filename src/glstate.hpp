@@ -0,0 +1,62 @@
+#pragma once
+
+/// @brief Shadow copy of the bind points and fixed function state the renderer touches
+/// Calls that would not change anything are dropped before they reach the driver. The element array binding lives in
+/// the VAO and glBindBufferBase rewrites the generic SSBO/UBO targets, so those go straight through untracked.
+/// Objects have to be forgotten before they are deleted since GL unbinds them behind our back.
+class GLState {
+public:
+    static constexpr GLuint MaxTextureUnits = 32;
+
+    static void UseProgram(GLuint program);
+    static void BindVertexArray(GLuint vao);
+    static void BindTexture(GLuint unit, GLenum target, GLuint texture);
+    static void BindBuffer(GLenum target, GLuint buffer);
+
+    static void Enable(GLenum capability) { SetCapability(capability, true); }
+    static void Disable(GLenum capability) { SetCapability(capability, false); }
+    static void SetCapability(GLenum capability, bool enabled);
+    static void PolygonMode(GLenum mode);
+    static void BlendFunc(GLenum source, GLenum destination);
+    static void DepthFunc(GLenum func);
+
+    static void ForgetProgram(GLuint program);
+    static void ForgetVertexArray(GLuint vao);
+    static void ForgetTexture(GLuint texture);
+    static void ForgetBuffer(GLuint buffer);
+    static void Invalidate(); // after state was changed behind the tracker
+
+    static void SetValidation(bool enabled) { validate = enabled; } // debug builds only
+    static void EndFrame();
+    static uint32_t GetSkipped() { return lastSkipped; } // redundant calls dropped last frame
+
+private:
+    static constexpr GLuint Unknown = std::numeric_limits<GLuint>::max();
+
+    enum TextureTarget { Texture2D, TextureCube, TextureTargetCount };
+    enum BufferTarget { ArrayBuffer, CopyRead, CopyWrite, DrawIndirect, DispatchIndirect, PixelPack, PixelUnpack, BufferTargetCount };
+    enum Capability { Blend, DepthTest, CullFace, StencilTest, ScissorTest, CapabilityCount };
+
+    static int TextureTargetIndex(GLenum target);
+    static int BufferTargetIndex(GLenum target);
+    static int CapabilityIndex(GLenum capability);
+    static void ActiveTexture(GLuint unit);
+    static void Check(const char* name, GLenum query, GLuint& shadow); // resets the shadow on a mismatch
+    static void Skip() { skipped++; }
+
+    // Starts out as the defaults of a fresh context, Unknown/-1 forces the next call through
+    static inline GLuint program{ 0 };
+    static inline GLuint vertexArray{ 0 };
+    static inline GLuint activeUnit{ 0 };
+    static inline std::array<std::array<GLuint, TextureTargetCount>, MaxTextureUnits> textures{};
+    static inline std::array<GLuint, BufferTargetCount> buffers{};
+    static inline std::array<int8_t, CapabilityCount> capabilities{};
+    static inline GLenum polygonMode{ GL_FILL };
+    static inline GLenum blendSource{ GL_ONE };
+    static inline GLenum blendDestination{ GL_ZERO };
+    static inline GLenum depthFunc{ GL_LESS };
+
+    static inline bool validate{ false };
+    static inline uint32_t skipped{ 0 };
+    static inline uint32_t lastSkipped{ 0 };
+};
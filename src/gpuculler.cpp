@@ -0,0 +1,178 @@
+#include "gpuculler.hpp"
+#include "shader.hpp"
+#include "shadervariants.hpp"
+#include "mesh.hpp"
+#include "model.hpp"
+#include "frustum.hpp"
+#include "opengl.hpp"
+#include "glstate.hpp"
+
+GpuCuller::GpuCuller() : shader{std::make_unique<Shader>()} {
+    shader->link("resources/shaders/cullShader.comp");
+
+    for (auto buffer : { &boundsBuffer, &objectBuffer, &batchBuffer, &inputBuffer, &outputBuffer, &commandBuffer, &templateBuffer }) {
+        glCall(glGenBuffers, 1, buffer);
+    }
+}
+
+GpuCuller::~GpuCuller() {
+    for (auto buffer : { &boundsBuffer, &objectBuffer, &batchBuffer, &inputBuffer, &outputBuffer, &commandBuffer, &templateBuffer }) {
+        GLState::ForgetBuffer(*buffer);
+        glCall(glDeleteBuffers, 1, buffer);
+    }
+}
+
+void GpuCuller::add(const Model* model, const Instance& instance, const glm::vec4& sphere) {
+    std::vector<const Mesh*> meshes;
+    for (const auto& mesh : model->getMeshes()) {
+        meshes.push_back(mesh.get());
+    }
+
+    objectBatches.push_back(getBatch(model, meshes));
+    instances.push_back(instance);
+    bounds.push_back(sphere);
+}
+
+void GpuCuller::add(const Mesh* mesh, const Instance& instance, const glm::vec4& sphere) {
+    objectBatches.push_back(getBatch(mesh, { mesh }));
+    instances.push_back(instance);
+    bounds.push_back(sphere);
+}
+
+uint32_t GpuCuller::getBatch(const void* key, const std::vector<const Mesh*>& meshes) {
+    auto [it, inserted] = batchIds.try_emplace(key, static_cast<uint32_t>(batches.size()));
+    if (inserted) {
+        for (const auto* mesh : meshes) {
+            assert(mesh->inArena && "GPU culled meshes must live in the geometry arena");
+        }
+        batches.push_back({ meshes, 0 });
+    }
+    batches[it->second].objects++;
+    return it->second;
+}
+
+void GpuCuller::build() {
+    // Order batches by material so their commands can be merged into as few multi-draw calls as possible
+    std::vector<uint32_t> order(batches.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        const auto* ma = batches[a].meshes.front();
+        const auto* mb = batches[b].meshes.front();
+        const void* ta = ma->textures.empty() ? nullptr : ma->textures.front().get();
+        const void* tb = mb->textures.empty() ? nullptr : mb->textures.front().get();
+        return std::tie(ta, ma->mode) < std::tie(tb, mb->mode);
+    });
+
+    std::vector<glm::uvec4> batchData(batches.size());
+    uint32_t instanceOffset = 0;
+
+    for (auto id : order) {
+        const auto& batch = batches[id];
+        batchData[id] = { instanceOffset, static_cast<uint32_t>(commands.size()), static_cast<uint32_t>(batch.meshes.size()), 0 };
+
+        for (const auto* mesh : batch.meshes) {
+            commands.push_back({ static_cast<GLuint>(mesh->elementCount), 0, mesh->firstIndex, mesh->baseVertex, instanceOffset });
+            commandBatches.push_back(id);
+            commandMeshes.push_back(mesh);
+        }
+
+        instanceOffset += batch.objects;
+    }
+
+    for (size_t first = 0; first < commandMeshes.size();) {
+        const auto* mesh = commandMeshes[first];
+        size_t last = first + 1;
+        while (last < commandMeshes.size() && commandMeshes[last]->mode == mesh->mode && commandMeshes[last]->textures == mesh->textures)
+            last++;
+        groups.emplace_back(first, last - first);
+        first = last;
+    }
+
+    auto upload = [](GLuint buffer, GLsizeiptr size, const void* data, GLenum usage) {
+        GLState::BindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glCall(glBufferData, GL_COPY_WRITE_BUFFER, size, data, usage);
+    };
+
+    upload(boundsBuffer, bounds.size() * sizeof(glm::vec4), bounds.data(), GL_STATIC_DRAW);
+    upload(objectBuffer, objectBatches.size() * sizeof(uint32_t), objectBatches.data(), GL_STATIC_DRAW);
+    upload(batchBuffer, batchData.size() * sizeof(glm::uvec4), batchData.data(), GL_STATIC_DRAW);
+    upload(inputBuffer, instances.size() * sizeof(Instance), instances.data(), GL_STATIC_DRAW);
+    upload(outputBuffer, instances.size() * sizeof(Instance), nullptr, GL_DYNAMIC_COPY);
+    upload(commandBuffer, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data(), GL_DYNAMIC_COPY);
+    upload(templateBuffer, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data(), GL_STATIC_COPY);
+    GLState::BindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    std::cout << "GPU culling " << bounds.size() << " objects in " << batches.size() << " batches, " << groups.size() << " draw calls" << std::endl;
+}
+
+void GpuCuller::cull(const Frustum& frustum) {
+    if (bounds.empty())
+        return;
+
+    // Reset instance counts
+    GLState::BindBuffer(GL_COPY_READ_BUFFER, templateBuffer);
+    GLState::BindBuffer(GL_COPY_WRITE_BUFFER, commandBuffer);
+    glCall(glCopyBufferSubData, GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, commands.size() * sizeof(DrawElementsIndirectCommand));
+
+    shader->use();
+    for (int i = 0; i < 6; i++) {
+        shader->setUniform({ "u_planes[", static_cast<uint32_t>(i), "]" }, frustum.planes[i]);
+    }
+    shader->setUniform("u_count", static_cast<int>(bounds.size()));
+
+    GLuint binding = 0;
+    for (auto buffer : { boundsBuffer, objectBuffer, batchBuffer, inputBuffer, outputBuffer, commandBuffer }) {
+        glCall(glBindBufferBase, GL_SHADER_STORAGE_BUFFER, binding++, buffer);
+    }
+
+    glCall(glDispatchCompute, (static_cast<GLuint>(bounds.size()) + 63) / 64, 1, 1);
+    glCall(glMemoryBarrier, GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+}
+
+void GpuCuller::render(ShaderVariants& variants, uint32_t features) const {
+    if (commands.empty())
+        return;
+
+    GLState::BindVertexArray(GeometryArena::Get()->getInstancedVao());
+    glCall(glBindVertexBuffer, Mesh::InstanceBinding, outputBuffer, 0, sizeof(Instance));
+    GLState::BindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+
+    for (const auto& [first, count] : groups) {
+        const auto* mesh = commandMeshes[first];
+        auto& program = variants.get(features | mesh->getShaderFeatures());
+        if (!program.isReady())
+            continue;
+        program.use();
+        mesh->bindTextures(program);
+        glCall(glMultiDrawElementsIndirect, mesh->mode, GL_UNSIGNED_INT, (GLvoid*)(first * sizeof(DrawElementsIndirectCommand)), static_cast<GLsizei>(count), 0);
+    }
+}
+
+bool GpuCuller::validate(const Frustum& frustum) const {
+    if (bounds.empty())
+        return true;
+
+    std::vector<DrawElementsIndirectCommand> result(commands.size());
+
+    glCall(glMemoryBarrier, GL_BUFFER_UPDATE_BARRIER_BIT);
+    GLState::BindBuffer(GL_COPY_READ_BUFFER, commandBuffer);
+    glCall(glGetBufferSubData, GL_COPY_READ_BUFFER, 0, result.size() * sizeof(DrawElementsIndirectCommand), result.data());
+    GLState::BindBuffer(GL_COPY_READ_BUFFER, 0);
+
+    // CPU reference
+    std::vector<uint32_t> expected(batches.size(), 0);
+    for (size_t i = 0; i < bounds.size(); i++) {
+        if (frustum.checkSphere(glm::vec3{ bounds[i] }, bounds[i].w)) {
+            expected[objectBatches[i]]++;
+        }
+    }
+
+    bool success = true;
+    for (size_t i = 0; i < result.size(); i++) {
+        if (result[i].instanceCount != expected[commandBatches[i]]) {
+            std::cerr << "ERROR: GPU culling mismatch in command " << i << ": " << result[i].instanceCount << " visible, expected " << expected[commandBatches[i]] << std::endl;
+            success = false;
+        }
+    }
+    return success;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "vertex.hpp"
+#include "geometryarena.hpp"
+
+class Shader;
+class ShaderVariants;
+class Mesh;
+class Model;
+class Frustum;
+
+/// @brief Frustum culling of static instances in a compute shader
+/// Bounds and instance data are uploaded once in build(). Each frame cull() tests every sphere against the
+/// frustum planes on the GPU and appends survivors to an instance buffer, counting them with atomics straight
+/// into the indirect commands, so render() only has to issue the multi-draw calls.
+/// Requires every registered mesh to live in the geometry arena.
+class GpuCuller {
+public:
+    GpuCuller();
+    ~GpuCuller();
+
+    void add(const Model* model, const Instance& instance, const glm::vec4& sphere);
+    void add(const Mesh* mesh, const Instance& instance, const glm::vec4& sphere);
+    void build();
+
+    void cull(const Frustum& frustum);
+    void render(ShaderVariants& variants, uint32_t features) const;
+
+    // Compares the GPU visible counts against the CPU Frustum::checkSphere reference, stalls the pipeline
+    bool validate(const Frustum& frustum) const;
+
+    uint32_t getObjectCount() const { return static_cast<uint32_t>(bounds.size()); }
+
+private:
+    struct Batch {
+        std::vector<const Mesh*> meshes;
+        uint32_t objects{ 0 };
+    };
+
+    std::unique_ptr<Shader> shader;
+    GLuint boundsBuffer, objectBuffer, batchBuffer, inputBuffer, outputBuffer, commandBuffer;
+    GLuint templateBuffer; // commands with zero instances, copied over the command buffer every frame
+
+    std::vector<glm::vec4> bounds;
+    std::vector<Instance> instances;
+    std::vector<uint32_t> objectBatches;
+    std::vector<Batch> batches;
+    std::unordered_map<const void*, uint32_t> batchIds;
+
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<uint32_t> commandBatches;
+    std::vector<const Mesh*> commandMeshes;
+    std::vector<std::pair<size_t, size_t>> groups; // command ranges drawn with one multi-draw call
+
+    uint32_t getBatch(const void* key, const std::vector<const Mesh*>& meshes);
+};
@@ -0,0 +1,166 @@
+#include "jobsystem.hpp"
+
+std::vector<std::thread> JobSystem::workers;
+std::vector<std::unique_ptr<JobSystem::Queue>> JobSystem::queues;
+std::atomic<bool> JobSystem::running{ false };
+std::atomic<uint32_t> JobSystem::pending{ 0 };
+std::mutex JobSystem::sleepMutex;
+std::condition_variable JobSystem::wake;
+thread_local uint32_t JobSystem::index{ UINT32_MAX };
+
+uint32_t JobSystem::DefaultWorkerCount() {
+    // leave one core for the main thread
+    uint32_t cores = std::thread::hardware_concurrency();
+    return cores > 1 ? cores - 1 : 0;
+}
+
+void JobSystem::Init(uint32_t count) {
+    assert(workers.empty() && "Job system is already running!");
+
+    queues.clear();
+    for (uint32_t i = 0; i < count + 1; i++) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+
+    running = true;
+    for (uint32_t i = 0; i < count; i++) {
+        workers.emplace_back(WorkerLoop, i);
+    }
+
+    std::cout << "Job system started with " << count << " workers" << std::endl;
+}
+
+void JobSystem::Shutdown() {
+    {
+        std::lock_guard<std::mutex> lock{ sleepMutex };
+        running = false;
+    }
+    wake.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+    queues.clear();
+}
+
+void JobSystem::Run(Job job, Counter* counter, const Counter* dependency) {
+    if (counter)
+        counter->value.fetch_add(1, std::memory_order_relaxed);
+
+    if (workers.empty()) {
+        // single-thread mode: run in submission order
+        if (dependency)
+            Wait(*dependency);
+        job();
+        if (counter)
+            counter->value.fetch_sub(1, std::memory_order_release);
+        return;
+    }
+
+    Push({ std::move(job), counter, dependency });
+}
+
+void JobSystem::Wait(const Counter& counter) {
+    while (!counter.done()) {
+        if (!Execute())
+            std::this_thread::yield();
+    }
+}
+
+void JobSystem::ParallelFor(uint32_t begin, uint32_t end, uint32_t grain, const std::function<void(uint32_t, uint32_t)>& function) {
+    if (begin >= end)
+        return;
+
+    grain = std::max(grain, 1u);
+
+    if (workers.empty() || end - begin <= grain) {
+        function(begin, end);
+        return;
+    }
+
+    Counter counter;
+    for (uint32_t first = begin; first < end; first += grain) {
+        uint32_t last = std::min(first + grain, end);
+        Run([&function, first, last] { function(first, last); }, &counter);
+    }
+    Wait(counter);
+}
+
+void JobSystem::WorkerLoop(uint32_t id) {
+    index = id;
+
+    while (running) {
+        if (Execute())
+            continue;
+
+        // the timeout covers a push racing with going to sleep
+        std::unique_lock<std::mutex> lock{ sleepMutex };
+        wake.wait_for(lock, std::chrono::milliseconds(1), [] { return !running || pending > 0; });
+    }
+}
+
+void JobSystem::Push(Task&& task, bool front) {
+    // external threads share the last queue
+    auto& queue = *queues[std::min(index, static_cast<uint32_t>(queues.size()) - 1)];
+    {
+        std::lock_guard<std::mutex> lock{ queue.mutex };
+        if (front)
+            queue.tasks.push_front(std::move(task));
+        else
+            queue.tasks.push_back(std::move(task));
+    }
+
+    pending.fetch_add(1, std::memory_order_release);
+    wake.notify_one();
+}
+
+bool JobSystem::Pop(Task& task) {
+    auto count = static_cast<uint32_t>(queues.size());
+    uint32_t self = std::min(index, count - 1);
+
+    // own queue from the back (most recent, still hot in cache)
+    {
+        auto& queue = *queues[self];
+        std::lock_guard<std::mutex> lock{ queue.mutex };
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            return true;
+        }
+    }
+
+    // steal the oldest job from somebody else
+    for (uint32_t i = 1; i < count; i++) {
+        auto& queue = *queues[(self + i) % count];
+        std::lock_guard<std::mutex> lock{ queue.mutex };
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool JobSystem::Execute() {
+    Task task;
+    if (!Pop(task))
+        return false;
+
+    pending.fetch_sub(1, std::memory_order_relaxed);
+
+    if (task.dependency && !task.dependency->done()) {
+        // not ready yet, put it back behind the other work
+        Push(std::move(task), true);
+        return false;
+    }
+
+    task.job();
+
+    if (task.counter)
+        task.counter->value.fetch_sub(1, std::memory_order_release);
+
+    return true;
+}
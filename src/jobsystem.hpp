@@ -0,0 +1,56 @@
+#pragma once
+
+/// @brief Fixed-size worker pool with per-thread work-stealing deques
+/// Workers push and pop their own jobs LIFO and steal from the front of other deques when idle.
+/// Completion is tracked with counters: a job decrements its counter when done, Wait() helps executing
+/// jobs until the counter reaches zero, and a job can be held back until another counter reaches zero.
+/// With zero workers every job runs inline at submission, which gives a deterministic single-thread mode.
+class JobSystem {
+public:
+    using Job = std::function<void()>;
+
+    struct Counter {
+        std::atomic<uint32_t> value{ 0 };
+
+        bool done() const { return value.load(std::memory_order_acquire) == 0; }
+    };
+
+    static void Init(uint32_t workers);
+    static void Shutdown();
+
+    static void Run(Job job, Counter* counter = nullptr, const Counter* dependency = nullptr);
+    static void Wait(const Counter& counter);
+
+    /// Splits [begin, end) into chunks of at most grain elements, calls function(first, last) for each chunk
+    /// and returns when all of them are done.
+    static void ParallelFor(uint32_t begin, uint32_t end, uint32_t grain, const std::function<void(uint32_t, uint32_t)>& function);
+
+    static uint32_t GetWorkerCount() { return static_cast<uint32_t>(workers.size()); }
+    static uint32_t DefaultWorkerCount();
+
+private:
+    struct Task {
+        Job job;
+        Counter* counter;
+        const Counter* dependency;
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    static std::vector<std::thread> workers;
+    static std::vector<std::unique_ptr<Queue>> queues; // one per worker, the last one is shared by external threads
+    static std::atomic<bool> running;
+    static std::atomic<uint32_t> pending;
+    static std::mutex sleepMutex;
+    static std::condition_variable wake;
+
+    static thread_local uint32_t index;
+
+    static void WorkerLoop(uint32_t id);
+    static void Push(Task&& task, bool front = false);
+    static bool Pop(Task& task);
+    static bool Execute();
+};
@@ -0,0 +1,85 @@
+#include "lightbuffer.hpp"
+#include "opengl.hpp"
+#include "glstate.hpp"
+
+LightBuffer::LightBuffer() {
+    glCall(glGenBuffers, 1, &buffer);
+    reserve(64);
+}
+
+LightBuffer::~LightBuffer() {
+    GLState::ForgetBuffer(buffer);
+    glCall(glDeleteBuffers, 1, &buffer);
+}
+
+void LightBuffer::update(const DirectionalLight& directional, const std::vector<PointLight>& points, const std::vector<SpotLight>& spots) {
+    staging.clear();
+    for (const auto& light : points)
+        staging.push_back(light.pack());
+    for (const auto& light : spots)
+        staging.push_back(light.pack());
+
+    uploadedBytes = 0;
+
+    if (staging.size() > capacity)
+        reserve(std::max(staging.size(), capacity * 2));
+
+    Header current{ directional.pack(), static_cast<uint32_t>(points.size()), static_cast<uint32_t>(spots.size()) };
+    if (!valid || std::memcmp(&current, &header, sizeof(Header)) != 0) {
+        upload(0, sizeof(Header), &current);
+        header = current;
+    }
+
+    size_t previous = valid ? lights.size() : 0;
+    auto dirty = [&](size_t i) { return i >= previous || std::memcmp(&staging[i], &lights[i], sizeof(GpuLight)) != 0; };
+
+    for (size_t i = 0; i < staging.size();) {
+        if (!dirty(i)) {
+            i++;
+            continue;
+        }
+
+        // Extend the run over short clean gaps, one larger upload beats several tiny ones
+        size_t first = i, last = i + 1, next = last;
+        while (next < staging.size() && next < last + MergeGap) {
+            if (dirty(next))
+                last = next + 1;
+            next++;
+        }
+
+        upload(sizeof(Header) + first * sizeof(GpuLight), (last - first) * sizeof(GpuLight), &staging[first]);
+        i = next;
+    }
+
+    std::swap(lights, staging);
+    valid = true;
+}
+
+void LightBuffer::bind() const {
+    glCall(glBindBufferBase, GL_SHADER_STORAGE_BUFFER, Binding, buffer);
+}
+
+bool LightBuffer::BindObjectLights(StreamBuffer& stream, const std::vector<uint32_t>& indices) {
+    auto allocation = stream.allocate(std::max<GLsizeiptr>(indices.size(), 1) * sizeof(uint32_t), stream.getStorageAlignment());
+    if (!allocation)
+        return false;
+
+    if (!indices.empty())
+        std::memcpy(allocation.data, indices.data(), indices.size() * sizeof(uint32_t));
+    glCall(glBindBufferRange, GL_SHADER_STORAGE_BUFFER, ObjectBinding, allocation.buffer, allocation.offset, allocation.size);
+    return true;
+}
+
+void LightBuffer::reserve(size_t count) {
+    capacity = count;
+    valid = false; // everything is uploaded again
+
+    GLState::BindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glCall(glBufferData, GL_COPY_WRITE_BUFFER, sizeof(Header) + capacity * sizeof(GpuLight), (GLvoid*) nullptr, GL_DYNAMIC_DRAW);
+}
+
+void LightBuffer::upload(GLintptr offset, GLsizeiptr size, const void* data) {
+    GLState::BindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glCall(glBufferSubData, GL_COPY_WRITE_BUFFER, offset, size, data);
+    uploadedBytes += size;
+}
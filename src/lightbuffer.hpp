@@ -0,0 +1,47 @@
+#pragma once
+
+#include "lights.hpp"
+#include "streambuffer.hpp"
+
+/// @brief Shader storage block holding every light of a frame
+/// The last uploaded contents are kept on the CPU, each update compares against them and only rewrites the
+/// header and the runs of lights that changed. Point lights are stored first, spot lights follow.
+class LightBuffer {
+public:
+    static constexpr GLuint Binding = 8; // must match LightBlock in mainShader.frag
+    static constexpr GLuint ObjectBinding = 11; // ObjectLightBlock
+
+    LightBuffer();
+    ~LightBuffer();
+
+    void update(const DirectionalLight& directional, const std::vector<PointLight>& points, const std::vector<SpotLight>& spots);
+    void bind() const;
+
+    // Light indices the instances of the frame point into with Instance::lights, false when the stream is full
+    static bool BindObjectLights(StreamBuffer& stream, const std::vector<uint32_t>& indices);
+
+    size_t getUploadedBytes() const { return uploadedBytes; } // by the last update
+
+private:
+    struct Header {
+        GpuDirectionalLight directional;
+        uint32_t pointCount;
+        uint32_t spotCount;
+        uint32_t padding[2];
+    };
+
+    static_assert(sizeof(Header) == 48);
+
+    static constexpr size_t MergeGap = 4; // unchanged lights between two changed runs that are uploaded anyway
+
+    GLuint buffer{ 0 };
+    size_t capacity{ 0 };
+    bool valid{ false };
+    Header header{};
+    std::vector<GpuLight> lights; // as uploaded
+    std::vector<GpuLight> staging;
+    size_t uploadedBytes{ 0 };
+
+    void reserve(size_t count);
+    void upload(GLintptr offset, GLsizeiptr size, const void* data);
+};
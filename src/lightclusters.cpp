@@ -0,0 +1,209 @@
+#include "lightclusters.hpp"
+#include "opengl.hpp"
+#include "jobsystem.hpp"
+#include "profiler.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define LIGHT_CLUSTERS_SSE
+#endif
+
+LightClusters::LightClusters(StreamBuffer& stream) : stream{stream}, cells(Count) {
+    for (auto* axis : { &minX, &minY, &minZ, &maxX, &maxY, &maxZ })
+        axis->resize(Count);
+}
+
+bool LightClusters::update(const glm::mat4& view, const glm::mat4& projection, const glm::ivec2& viewport,
+                           const std::vector<PointLight>& points, const std::vector<SpotLight>& spots) {
+    PROFILE_SCOPE("light clusters");
+
+    if (projection != this->projection)
+        build(projection);
+
+    // Spot lights are bounded by the sphere around their cone
+    bounds.resize(points.size() + spots.size());
+    std::vector<uint8_t> visible(bounds.size());
+    JobSystem::ParallelFor(0, static_cast<uint32_t>(bounds.size()), 256, [&](uint32_t first, uint32_t last) {
+        for (uint32_t i = first; i < last; i++) {
+            const PointLight& light = i < points.size() ? points[i] : spots[i - points.size()];
+            visible[i] = cover(view, light.position, light.range(), i, bounds[i]);
+        }
+    });
+
+    size_t kept = 0;
+    for (size_t i = 0; i < bounds.size(); i++) {
+        if (visible[i])
+            bounds[kept++] = bounds[i];
+    }
+    bounds.resize(kept);
+
+    JobSystem::ParallelFor(0, Slices, 1, [this](uint32_t first, uint32_t last) {
+        for (uint32_t z = first; z < last; z++)
+            assign(z);
+    });
+
+    references = 0;
+    maxPerCluster = 0;
+    for (const auto& cell : cells) {
+        references += static_cast<uint32_t>(cell.size());
+        maxPerCluster = std::max(maxPerCluster, static_cast<uint32_t>(cell.size()));
+    }
+
+    clusterData = stream.allocate(sizeof(Header) + Count * 2 * sizeof(uint32_t), stream.getStorageAlignment());
+    lightData = stream.allocate(std::max<GLsizeiptr>(references, 1) * sizeof(uint32_t), stream.getStorageAlignment());
+    if (!clusterData || !lightData)
+        return false;
+
+    Header header{ glm::vec2{ viewport } / glm::vec2{ TilesX, TilesY }, sliceScale, sliceBias, { TilesX, TilesY, Slices, 0 } };
+    std::memcpy(clusterData.data, &header, sizeof(Header));
+
+    auto* ranges = reinterpret_cast<uint32_t*>(static_cast<uint8_t*>(clusterData.data) + sizeof(Header));
+    auto* indices = static_cast<uint32_t*>(lightData.data);
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < Count; i++) {
+        auto count = static_cast<uint32_t>(cells[i].size());
+        ranges[2 * i] = offset;
+        ranges[2 * i + 1] = count;
+        if (count)
+            std::memcpy(indices + offset, cells[i].data(), count * sizeof(uint32_t));
+        offset += count;
+    }
+
+    return true;
+}
+
+void LightClusters::bind() const {
+    glCall(glBindBufferRange, GL_SHADER_STORAGE_BUFFER, Binding, clusterData.buffer, clusterData.offset, clusterData.size);
+    glCall(glBindBufferRange, GL_SHADER_STORAGE_BUFFER, LightBinding, lightData.buffer, lightData.offset, lightData.size);
+}
+
+void LightClusters::build(const glm::mat4& matrix) {
+    projection = matrix;
+
+    // Only a perspective projection has the depth slices this grid is made of
+    near = projection[3][2] / (projection[2][2] - 1.0f);
+    far = projection[3][2] / (projection[2][2] + 1.0f);
+    sliceScale = static_cast<float>(Slices) / std::log(far / near);
+    sliceBias = -static_cast<float>(Slices) * std::log(near) / std::log(far / near);
+
+    // Rays through the tile corners, scaled to unit view depth
+    auto inverse = glm::inverse(projection);
+    std::vector<glm::vec3> rays((TilesX + 1) * (TilesY + 1));
+    for (uint32_t y = 0; y <= TilesY; y++) {
+        for (uint32_t x = 0; x <= TilesX; x++) {
+            glm::vec4 point = inverse * glm::vec4{ -1.0f + 2.0f * x / TilesX, -1.0f + 2.0f * y / TilesY, -1.0f, 1.0f };
+            glm::vec3 ray{ point / point.w };
+            rays[y * (TilesX + 1) + x] = ray / -ray.z;
+        }
+    }
+
+    for (uint32_t z = 0; z < Slices; z++) {
+        float depths[2] = { near * std::pow(far / near, static_cast<float>(z) / Slices), near * std::pow(far / near, static_cast<float>(z + 1) / Slices) };
+        for (uint32_t y = 0; y < TilesY; y++) {
+            for (uint32_t x = 0; x < TilesX; x++) {
+                glm::vec3 low{ std::numeric_limits<float>::max() };
+                glm::vec3 high{ std::numeric_limits<float>::lowest() };
+                for (uint32_t corner = 0; corner < 4; corner++) {
+                    const auto& ray = rays[(y + corner / 2) * (TilesX + 1) + x + corner % 2];
+                    for (float depth : depths) {
+                        low = glm::min(low, ray * depth);
+                        high = glm::max(high, ray * depth);
+                    }
+                }
+
+                uint32_t i = (z * TilesY + y) * TilesX + x;
+                minX[i] = low.x;
+                minY[i] = low.y;
+                minZ[i] = low.z;
+                maxX[i] = high.x;
+                maxY[i] = high.y;
+                maxZ[i] = high.z;
+            }
+        }
+    }
+}
+
+bool LightClusters::cover(const glm::mat4& view, const glm::vec3& position, float radius, uint32_t index, Bounds& light) const {
+    glm::vec3 center{ view * glm::vec4{ position, 1.0f } };
+    float front = -center.z - radius;
+    float back = -center.z + radius;
+    if (radius <= 0.0f || back < near || front > far)
+        return false;
+
+    light = { center, radius, index, 0, TilesX - 1, 0, TilesY - 1, slice(std::max(front, near)), slice(std::min(back, far)) };
+
+    // A sphere reaching past the near plane can cover any tile
+    if (front <= near)
+        return true;
+
+    // Otherwise the projected corners of its box bound it on screen
+    glm::vec2 low{ std::numeric_limits<float>::max() };
+    glm::vec2 high{ std::numeric_limits<float>::lowest() };
+    for (uint32_t corner = 0; corner < 8; corner++) {
+        glm::vec3 offset{ corner & 1 ? radius : -radius, corner & 2 ? radius : -radius, corner & 4 ? radius : -radius };
+        glm::vec4 clip = projection * glm::vec4{ center + offset, 1.0f };
+        glm::vec2 ndc{ clip / clip.w };
+        low = glm::min(low, ndc);
+        high = glm::max(high, ndc);
+    }
+
+    if (high.x < -1.0f || high.y < -1.0f || low.x > 1.0f || low.y > 1.0f)
+        return false;
+
+    auto tile = [](float ndc, uint32_t tiles) {
+        return static_cast<uint32_t>(glm::clamp((ndc * 0.5f + 0.5f) * tiles, 0.0f, tiles - 1.0f));
+    };
+    light.x0 = tile(low.x, TilesX);
+    light.x1 = tile(high.x, TilesX);
+    light.y0 = tile(low.y, TilesY);
+    light.y1 = tile(high.y, TilesY);
+    return true;
+}
+
+void LightClusters::assign(uint32_t z) {
+    for (uint32_t i = z * TilesX * TilesY; i < (z + 1) * TilesX * TilesY; i++)
+        cells[i].clear();
+
+    for (const auto& light : bounds) {
+        if (z < light.z0 || z > light.z1)
+            continue;
+
+        float radius2 = light.radius * light.radius;
+        for (uint32_t y = light.y0; y <= light.y1; y++) {
+            uint32_t row = (z * TilesY + y) * TilesX;
+            for (uint32_t x = light.x0 & ~3u; x <= light.x1; x += 4) {
+                // Squared distance from the center to each box, a lane is set where the sphere reaches in
+                uint32_t i = row + x;
+                int mask = 0;
+#ifdef LIGHT_CLUSTERS_SSE
+                auto distance = [&](const std::vector<float>& low, const std::vector<float>& high, float center) {
+                    __m128 c = _mm_set1_ps(center);
+                    __m128 below = _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&low[i]), c), _mm_setzero_ps());
+                    __m128 above = _mm_max_ps(_mm_sub_ps(c, _mm_loadu_ps(&high[i])), _mm_setzero_ps());
+                    __m128 d = _mm_add_ps(below, above);
+                    return _mm_mul_ps(d, d);
+                };
+                __m128 d2 = _mm_add_ps(_mm_add_ps(distance(minX, maxX, light.center.x), distance(minY, maxY, light.center.y)), distance(minZ, maxZ, light.center.z));
+                mask = _mm_movemask_ps(_mm_cmple_ps(d2, _mm_set1_ps(radius2)));
+#else
+                for (uint32_t lane = 0; lane < 4; lane++) {
+                    glm::vec3 low{ minX[i + lane], minY[i + lane], minZ[i + lane] };
+                    glm::vec3 high{ maxX[i + lane], maxY[i + lane], maxZ[i + lane] };
+                    glm::vec3 d = glm::max(low - light.center, 0.0f) + glm::max(light.center - high, 0.0f);
+                    if (glm::dot(d, d) <= radius2)
+                        mask |= 1 << lane;
+                }
+#endif
+                for (uint32_t lane = 0; lane < 4; lane++) {
+                    if ((mask & (1 << lane)) && x + lane >= light.x0 && x + lane <= light.x1)
+                        cells[i + lane].push_back(light.index);
+                }
+            }
+        }
+    }
+}
+
+uint32_t LightClusters::slice(float depth) const {
+    float index = std::log(depth) * sliceScale + sliceBias;
+    return static_cast<uint32_t>(glm::clamp(index, 0.0f, Slices - 1.0f));
+}
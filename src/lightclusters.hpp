@@ -0,0 +1,71 @@
+#pragma once
+
+#include "lights.hpp"
+#include "streambuffer.hpp"
+
+/// @brief Lights sorted into a grid of clusters over the view frustum
+/// The frustum is split into screen tiles and exponentially spaced depth slices. Every frame each light's range
+/// sphere is tested against the view space bounds of the clusters it may touch, one depth slice per job and four
+/// clusters of a row per SIMD test. The fragment shader then only shades the lights listed for its own cluster.
+/// Light indices refer to the order of LightBuffer: point lights first, spot lights after them.
+class LightClusters {
+public:
+    static constexpr uint32_t TilesX = 16;
+    static constexpr uint32_t TilesY = 9;
+    static constexpr uint32_t Slices = 24;
+    static constexpr uint32_t Count = TilesX * TilesY * Slices;
+    static constexpr GLuint Binding = 9; // must match ClusterBlock in mainShader.frag
+    static constexpr GLuint LightBinding = 10; // ClusterLightBlock
+
+    static_assert(TilesX % 4 == 0, "rows are tested four clusters at a time");
+
+    explicit LightClusters(StreamBuffer& stream);
+
+    // False when the stream buffer ran out of space this frame, the caller has to shade without clusters
+    bool update(const glm::mat4& view, const glm::mat4& projection, const glm::ivec2& viewport,
+                const std::vector<PointLight>& points, const std::vector<SpotLight>& spots);
+    void bind() const;
+
+    uint32_t getReferenceCount() const { return references; } // light indices written by the last update
+    uint32_t getMaxPerCluster() const { return maxPerCluster; }
+
+private:
+    struct Header {
+        glm::vec2 tileSize;
+        float sliceScale;
+        float sliceBias;
+        uint32_t tiles[4];
+    };
+
+    static_assert(sizeof(Header) == 32);
+
+    // A light in view space with the range of clusters its sphere overlaps
+    struct Bounds {
+        glm::vec3 center;
+        float radius;
+        uint32_t index;
+        uint32_t x0, x1, y0, y1, z0, z1;
+    };
+
+    StreamBuffer& stream;
+    glm::mat4 projection{ 0.0f };
+    float near{ 0.0f };
+    float far{ 0.0f };
+    float sliceScale{ 0.0f };
+    float sliceBias{ 0.0f };
+
+    // View space cluster bounds, x runs fastest so a row of neighbours loads as one vector
+    std::vector<float> minX, minY, minZ, maxX, maxY, maxZ;
+
+    std::vector<Bounds> bounds;
+    std::vector<std::vector<uint32_t>> cells; // light indices per cluster, only the job owning the slice writes
+    StreamBuffer::Allocation clusterData;
+    StreamBuffer::Allocation lightData;
+    uint32_t references{ 0 };
+    uint32_t maxPerCluster{ 0 };
+
+    void build(const glm::mat4& projection);
+    bool cover(const glm::mat4& view, const glm::vec3& position, float radius, uint32_t index, Bounds& light) const;
+    void assign(uint32_t slice);
+    uint32_t slice(float depth) const;
+};
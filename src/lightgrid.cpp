@@ -0,0 +1,104 @@
+#include "lightgrid.hpp"
+
+void LightGrid::build(const std::vector<PointLight>& points, const std::vector<SpotLight>& spots) {
+    volumes.clear();
+    unbounded.clear();
+    cells.clear();
+
+    for (const auto& light : points)
+        volumes.push_back({ light.position, light.range(), glm::vec3{ 0.0f } });
+    for (const auto& light : spots) {
+        float cosine = glm::clamp(light.cutoff, -1.0f, 1.0f);
+        volumes.push_back({ light.position, light.range(), glm::normalize(light.direction), cosine, std::sqrt(1.0f - cosine * cosine) });
+    }
+
+    for (uint32_t i = 0; i < volumes.size(); i++) {
+        const auto& volume = volumes[i];
+        if (volume.range <= 0.0f)
+            continue;
+
+        if (!fits(volume.range)) {
+            unbounded.push_back(i);
+            continue;
+        }
+
+        auto low = cell(volume.position - volume.range);
+        auto high = cell(volume.position + volume.range);
+        for (int z = low.z; z <= high.z; z++) {
+            for (int y = low.y; y <= high.y; y++) {
+                for (int x = low.x; x <= high.x; x++)
+                    cells.emplace_back(Key(x, y, z), i);
+            }
+        }
+    }
+
+    std::sort(cells.begin(), cells.end());
+}
+
+void LightGrid::query(const glm::vec3& center, float radius, std::vector<uint32_t>& indices) const {
+    size_t first = indices.size();
+
+    for (auto i : unbounded) {
+        if (Overlaps(volumes[i], center, radius))
+            indices.push_back(i);
+    }
+
+    if (!fits(radius)) {
+        // Faster to go through the lights than the cells
+        for (uint32_t i = 0; i < volumes.size(); i++) {
+            if (Overlaps(volumes[i], center, radius))
+                indices.push_back(i);
+        }
+    } else {
+        auto low = cell(center - radius);
+        auto high = cell(center + radius);
+        for (int z = low.z; z <= high.z; z++) {
+            for (int y = low.y; y <= high.y; y++) {
+                for (int x = low.x; x <= high.x; x++) {
+                    auto key = Key(x, y, z);
+                    auto it = std::lower_bound(cells.begin(), cells.end(), std::make_pair(key, uint32_t{ 0 }));
+                    for (; it != cells.end() && it->first == key; ++it) {
+                        if (Overlaps(volumes[it->second], center, radius))
+                            indices.push_back(it->second);
+                    }
+                }
+            }
+        }
+    }
+
+    // A light spanning several of the cells shows up once per cell
+    std::sort(indices.begin() + first, indices.end());
+    indices.erase(std::unique(indices.begin() + first, indices.end()), indices.end());
+}
+
+glm::ivec3 LightGrid::cell(const glm::vec3& position) const {
+    return glm::ivec3{ glm::floor(position / cellSize) };
+}
+
+bool LightGrid::fits(float radius) const {
+    // Cells a sphere may touch, checked before any cell coordinate could overflow
+    float span = 2.0f * radius / cellSize + 2.0f;
+    return span * span * span <= static_cast<float>(MaxCells);
+}
+
+uint64_t LightGrid::Key(int x, int y, int z) {
+    // 21 bits per axis, cells far enough apart to wrap around only cost a few extra sphere tests
+    auto axis = [](int value) { return static_cast<uint64_t>(static_cast<uint32_t>(value) & 0x1FFFFF); };
+    return (axis(x) << 42) | (axis(y) << 21) | axis(z);
+}
+
+bool LightGrid::Overlaps(const Volume& volume, const glm::vec3& center, float radius) {
+    glm::vec3 offset = center - volume.position;
+    float reach = volume.range + radius;
+    if (glm::dot(offset, offset) > reach * reach)
+        return false;
+
+    // Point lights, and cones too wide for the test below
+    if (volume.cosine <= 0.0f)
+        return true;
+
+    // Sphere against cone, from Bart Wronski's "Cull that cone"
+    float along = glm::dot(offset, volume.direction);
+    float across = std::sqrt(std::max(glm::dot(offset, offset) - along * along, 0.0f));
+    return volume.cosine * across - along * volume.sine <= radius && along >= -radius;
+}
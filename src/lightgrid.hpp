@@ -0,0 +1,39 @@
+#pragma once
+
+#include "lights.hpp"
+
+/// @brief Uniform grid over the light volumes of a frame, answers which lights reach a bounding sphere
+/// Each light is entered into every cell its range box overlaps as a (cell, light) pair, the pairs are sorted by cell
+/// so a query is one binary search per cell it touches. Lights that would fill more than MaxCells cells, like the
+/// ship's spot light whose range spans the whole scene, skip the grid and are tested by every query instead.
+/// Indices follow LightBuffer: point lights first, spot lights after them. Queries are safe to run in parallel.
+class LightGrid {
+public:
+    explicit LightGrid(float cellSize = 64.0f) : cellSize{cellSize} {}
+
+    void build(const std::vector<PointLight>& points, const std::vector<SpotLight>& spots);
+
+    // Appends the lights whose volume overlaps the sphere, each at most once and in increasing order
+    void query(const glm::vec3& center, float radius, std::vector<uint32_t>& indices) const;
+
+private:
+    static constexpr uint64_t MaxCells = 512;
+
+    struct Volume {
+        glm::vec3 position;
+        float range;
+        glm::vec3 direction; // spot lights only, the cone is tested as well
+        float cosine{ -1.0f };
+        float sine{ 0.0f };
+    };
+
+    float cellSize;
+    std::vector<Volume> volumes; // by light index
+    std::vector<uint32_t> unbounded;
+    std::vector<std::pair<uint64_t, uint32_t>> cells;
+
+    bool fits(float radius) const;
+    glm::ivec3 cell(const glm::vec3& position) const;
+    static uint64_t Key(int x, int y, int z);
+    static bool Overlaps(const Volume& volume, const glm::vec3& center, float radius);
+};
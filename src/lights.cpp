@@ -1,33 +1,32 @@
 #include "lights.hpp"
-#include "shader.hpp"
 
-void DirectionalLight::submit(const std::unique_ptr<Shader>& shader) const {
-    shader->setUniform("gDirectionalLight.Base.Color", color);
-    shader->setUniform("gDirectionalLight.Base.AmbientIntensity", ambientIntensity);
-    shader->setUniform("gDirectionalLight.Direction", glm::normalize(direction));
-    shader->setUniform("gDirectionalLight.Base.DiffuseIntensity", diffuseIntensity);
+GpuDirectionalLight DirectionalLight::pack() const {
+    return { color, ambientIntensity, glm::normalize(direction), diffuseIntensity };
 }
 
-void PointLight::submit(const std::unique_ptr<Shader>& shader, uint32_t point_light_index) const {
-    auto id = std::to_string(point_light_index);
-    shader->setUniform("gPointLights[" + id + "].Base.Color", color);
-    shader->setUniform("gPointLights[" + id + "].Base.AmbientIntensity", ambientIntensity);
-    shader->setUniform("gPointLights[" + id + "].Position", position);
-    shader->setUniform("gPointLights[" + id + "].Base.DiffuseIntensity", diffuseIntensity);
-    shader->setUniform("gPointLights[" + id + "].Atten.Constant", attenuation.constant);
-    shader->setUniform("gPointLights[" + id + "].Atten.Linear", attenuation.linear);
-    shader->setUniform("gPointLights[" + id + "].Atten.Exp", attenuation.exp);
+float PointLight::range() const {
+    // Brightest the light gets before attenuation, the 1 stands in for the specular term
+    float peak = 256.0f * std::max({ color.r, color.g, color.b }) * (ambientIntensity + diffuseIntensity + 1.0f);
+    if (peak <= attenuation.constant)
+        return 0.0f;
+
+    // Where constant + linear * d + exp * d^2 reaches the peak
+    if (attenuation.exp > 0.0f) {
+        float c = attenuation.constant - peak;
+        return (-attenuation.linear + std::sqrt(attenuation.linear * attenuation.linear - 4.0f * attenuation.exp * c)) / (2.0f * attenuation.exp);
+    }
+    if (attenuation.linear > 0.0f)
+        return (peak - attenuation.constant) / attenuation.linear;
+    return std::numeric_limits<float>::max();
+}
+
+GpuLight PointLight::pack() const {
+    return { color, ambientIntensity, position, diffuseIntensity, { attenuation.constant, attenuation.linear, attenuation.exp }, 0.0f, glm::vec3{ 0.0f }, range() };
 }
 
-void SpotLight::submit(const std::unique_ptr<Shader>& shader, uint32_t spot_light_index) const {
-    auto id = std::to_string(spot_light_index);
-    shader->setUniform("gSpotLights[" + id + "].Base.Base.Color", color);
-    shader->setUniform("gSpotLights[" + id + "].Base.Base.AmbientIntensity", ambientIntensity);
-    shader->setUniform("gSpotLights[" + id + "].Base.Position", position);
-    shader->setUniform("gSpotLights[" + id + "].Base.Base.DiffuseIntensity", diffuseIntensity);
-    shader->setUniform("gSpotLights[" + id + "].Base.Atten.Constant", attenuation.constant);
-    shader->setUniform("gSpotLights[" + id + "].Base.Atten.Linear", attenuation.linear);
-    shader->setUniform("gSpotLights[" + id + "].Base.Atten.Exp", attenuation.exp);
-    shader->setUniform("gSpotLights[" + id + "].Direction", glm::normalize(direction));
-    shader->setUniform("gSpotLights[" + id + "].Cutoff", cutoff);
-}
\ No newline at end of file
+GpuLight SpotLight::pack() const {
+    auto light = PointLight::pack();
+    light.direction = glm::normalize(direction);
+    light.cutoff = cutoff;
+    return light;
+}
@@ -1,6 +1,25 @@
 #pragma once
 
-class Shader;
+// std430 mirrors of the structs in mainShader.frag
+struct GpuDirectionalLight {
+    glm::vec3 color;
+    float ambientIntensity;
+    glm::vec3 direction;
+    float diffuseIntensity;
+};
+
+struct GpuLight {
+    glm::vec3 color;
+    float ambientIntensity;
+    glm::vec3 position;
+    float diffuseIntensity;
+    glm::vec3 attenuation; // constant, linear, exp
+    float cutoff;
+    glm::vec3 direction;
+    float range;
+};
+
+static_assert(sizeof(GpuDirectionalLight) == 32 && sizeof(GpuLight) == 64);
 
 struct BaseLight {
     glm::vec3 color{1.0f};
@@ -11,7 +30,7 @@ struct BaseLight {
 struct DirectionalLight : public BaseLight {
     glm::vec3 direction{0.0f};
 
-    void submit(const std::unique_ptr<Shader>& shader) const;
+    GpuDirectionalLight pack() const;
 };
 
 struct PointLight : public BaseLight {
@@ -22,12 +41,13 @@ struct PointLight : public BaseLight {
         float exp{0.001f};
     } attenuation;
 
-    void submit(const std::unique_ptr<Shader>& shader, uint32_t point_light_index) const;
+    float range() const; // past it the light adds less than 1/256 to any channel
+    GpuLight pack() const;
 };
 
 struct SpotLight : public PointLight {
     glm::vec3 direction{0.0f};
     float cutoff{0.0f};
 
-    void submit(const std::unique_ptr<Shader>& shader, uint32_t spot_light_index) const;
-};
\ No newline at end of file
+    GpuLight pack() const;
+};
@@ -0,0 +1,82 @@
+#include "game.hpp"
+#include "jobsystem.hpp"
+#include "glstate.hpp"
+#include "shadercache.hpp"
+
+int main(int args, char** argv) {
+    // The window is created with the game, so its options are read first
+    for (int i = 1; i < args; i++) {
+        std::string arg{ argv[i] };
+        if (arg == "--headless")
+            Game::backend = Window::Backend::Egl;
+        else if (arg == "--osmesa")
+            Game::backend = Window::Backend::OsMesa;
+        else if (arg == "--resolution" && i + 1 < args && std::sscanf(argv[i + 1], "%dx%d", &Game::resolution.x, &Game::resolution.y) == 2)
+            i++;
+    }
+
+    Game& game = Game::getInstance();
+    uint32_t jobs = JobSystem::DefaultWorkerCount();
+
+    for (int i = 1; i < args; i++) {
+        std::string arg{ argv[i] };
+        if (arg == "--merge-geometry")
+            game.mergeGeometry = true;
+        else if (arg == "--gpu-culling")
+            game.gpuCulling = true;
+        else if (arg == "--validate-culling")
+            game.validateCulling = true;
+        else if (arg == "--tick-rate" && i + 1 < args)
+            game.tickRate = std::max(std::stof(argv[++i]), 1.0f);
+        else if (arg == "--max-catch-up" && i + 1 < args)
+            game.maxCatchUpSteps = static_cast<uint32_t>(std::stoul(argv[++i]));
+        else if (arg == "--pipelined")
+            game.pipelined = true;
+        else if (arg == "--pipeline-depth" && i + 1 < args)
+            game.pipelineDepth = static_cast<uint32_t>(std::stoul(argv[++i]));
+        else if (arg == "--frames" && i + 1 < args)
+            game.frameLimit = std::stoull(argv[++i]);
+        else if (arg == "--dump-frames" && i + 1 < args)
+            game.dumpPath = argv[++i];
+        else if (arg == "--gl-debug" && i + 1 < args) {
+            std::string mode{ argv[++i] };
+            game.glDebugMode = mode == "sync" ? GLDebug::Mode::Sync : mode == "async" ? GLDebug::Mode::Async : mode == "poll" ? GLDebug::Mode::Poll : GLDebug::Mode::Off;
+        }
+        else if (arg == "--validate-gl-state")
+            GLState::SetValidation(true); // cross-checks the shadowed state with glGet, debug builds only
+        else if (arg == "--shader-cache" && i + 1 < args) {
+            std::string path{ argv[++i] };
+            ShaderCache::SetDirectory(path == "off" ? std::filesystem::path{} : std::filesystem::path{ path });
+        }
+        else if (arg == "--no-clustered-lighting")
+            game.clusteredLighting = false;
+        else if (arg == "--no-object-lights")
+            game.objectLights = false;
+        else if (arg == "--no-bvh-culling")
+            game.bvhCulling = false;
+        else if (arg == "--no-occlusion-culling")
+            game.occlusionCulling = false;
+        else if (arg == "--hot-reload")
+            game.hotReload = true;
+        else if (arg == "--sync-shaders")
+            Shader::SetAsync(false);
+        else if (arg == "--trace" && i + 1 < args)
+            game.tracePath = argv[++i];
+        else if (arg == "--jobs" && i + 1 < args)
+            jobs = static_cast<uint32_t>(std::stoul(argv[++i])); // 0 runs every job inline on the calling thread
+    }
+
+    JobSystem::Init(jobs);
+
+    try {
+        game.init();
+        game.run();
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        JobSystem::Shutdown();
+        return EXIT_FAILURE;
+    }
+
+    JobSystem::Shutdown();
+    return EXIT_SUCCESS;
+}
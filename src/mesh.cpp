@@ -1,10 +1,55 @@
 #include "mesh.hpp"
 #include "shader.hpp"
 #include "texture.hpp"
+#include "geometryarena.hpp"
 #include "opengl.hpp"
+#include "glstate.hpp"
+#include "shadervariants.hpp"
 
 #include <assimp/material.h>
 
+namespace {
+    // Closest point of triangle abc to p, by the Voronoi region p falls in (Ericson, Real-Time Collision Detection 5.1.5)
+    glm::vec3 ClosestPoint(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+        glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+        float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+        if (d1 <= 0.0f && d2 <= 0.0f)
+            return a;
+
+        glm::vec3 bp = p - b;
+        float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+        if (d3 >= 0.0f && d4 <= d3)
+            return b;
+
+        float vc = d1 * d4 - d3 * d2;
+        if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+            return a + ab * (d1 / (d1 - d3));
+
+        glm::vec3 cp = p - c;
+        float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+        if (d6 >= 0.0f && d5 <= d6)
+            return c;
+
+        float vb = d5 * d2 - d1 * d6;
+        if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+            return a + ac * (d2 / (d2 - d6));
+
+        float va = d3 * d6 - d5 * d4;
+        if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+            return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+        float denominator = 1.0f / (va + vb + vc);
+        return a + ab * (vb * denominator) + ac * (vc * denominator);
+    }
+
+    // Signed solid angle triangle abc covers seen from the origin (Van Oosterom and Strackee)
+    float SolidAngle(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+        float la = glm::length(a), lb = glm::length(b), lc = glm::length(c);
+        float denominator = la * lb * lc + glm::dot(a, b) * lc + glm::dot(a, c) * lb + glm::dot(b, c) * la;
+        return 2.0f * std::atan2(glm::dot(a, glm::cross(b, c)), denominator);
+    }
+}
+
 Mesh::Mesh(std::vector<Vertex>&& vertices, GLenum mode)
     : vertices{std::move(vertices)}
     , mode{mode}
@@ -47,92 +92,203 @@ Mesh::Mesh(std::vector<Vertex>&& vertices, std::vector<GLuint>&& indices, std::v
 }
 
 Mesh::~Mesh() {
+    if (inArena)
+        return;
+
+    GLState::ForgetVertexArray(vao);
+    GLState::ForgetVertexArray(instancedVao);
+    GLState::ForgetBuffer(vbo);
     glCall(glDeleteVertexArrays, 1, &vao);
+    glCall(glDeleteVertexArrays, 1, &instancedVao);
     glCall(glDeleteBuffers, 1, &vbo);
-    if (!indices.empty())
+    if (!indices.empty()) {
+        GLState::ForgetBuffer(ebo);
         glCall(glDeleteBuffers, 1, &ebo);
+    }
 }
 
 void Mesh::initMesh() {
     if (vertices.empty())
         assert("Vertices/Indices data buffer is empty");
 
-    glCall(glGenVertexArrays, 1, &vao);
-    glCall(glGenBuffers, 1, &vbo);
-    if (!indices.empty())
-        glCall(glGenBuffers, 1, &ebo);
+    std::vector<glm::vec3> positions;
+    positions.reserve(vertices.size());
+    for (const auto& vertex : vertices)
+        positions.push_back(vertex.position);
+    bounds = Bounds::FromPoints(positions);
+
+    // When the mesh encloses its origin a sphere this size lies inside it, occlusion culling uses it as occluder.
+    // The winding number around the origin tells, it stays near 0 outside a closed mesh whichever way it is wound
+    if (mode == GL_TRIANGLES) {
+        auto count = indices.empty() ? vertices.size() : indices.size();
+        auto position = [&](size_t i) { return vertices[indices.empty() ? i : indices[i]].position; };
+        float nearest = std::numeric_limits<float>::max();
+        double winding = 0.0;
+        for (size_t i = 0; i + 2 < count; i += 3) {
+            nearest = std::min(nearest, glm::length2(ClosestPoint(glm::vec3{ 0.0f }, position(i), position(i + 1), position(i + 2))));
+            winding += SolidAngle(position(i), position(i + 1), position(i + 2));
+        }
+        bool enclosed = std::abs(winding) >= 2.0 * glm::pi<double>();
+        innerRadius = count >= 3 && enclosed ? std::sqrt(nearest) : 0.0f;
+    }
 
-    glCall(glBindVertexArray, vao);
+    if (auto arena = GeometryArena::Get()) {
+        auto range = arena->allocate(vertices, indices);
+        vao = arena->getVao();
+        instancedVao = arena->getInstancedVao();
+        inArena = true;
+        baseVertex = range.baseVertex;
+        firstIndex = range.firstIndex;
+        elementCount = range.count;
+        return;
+    }
+
+    elementCount = static_cast<GLsizei>(indices.size());
 
-    glCall(glBindBuffer, GL_ARRAY_BUFFER, vbo);
+    glCall(glGenBuffers, 1, &vbo);
+    GLState::BindBuffer(GL_ARRAY_BUFFER, vbo);
     glCall(glBufferData, GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+    GLState::BindBuffer(GL_ARRAY_BUFFER, 0);
 
     if (!indices.empty()) {
-        glCall(glBindBuffer, GL_ELEMENT_ARRAY_BUFFER, ebo);
-        glCall(glBufferData, GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+        glCall(glGenBuffers, 1, &ebo);
+        GLState::BindBuffer(GL_COPY_WRITE_BUFFER, ebo);
+        glCall(glBufferData, GL_COPY_WRITE_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+        GLState::BindBuffer(GL_COPY_WRITE_BUFFER, 0);
     }
 
+    // Second vao shares the vertex/index buffers and adds per-instance attributes,
+    // the instance buffer itself is attached per draw
+    glCall(glGenVertexArrays, 1, &vao);
+    glCall(glGenVertexArrays, 1, &instancedVao);
+
+    for (auto id : { vao, instancedVao }) {
+        GLState::BindVertexArray(id);
+        SetupVertexAttributes();
+        glCall(glBindVertexBuffer, VertexBinding, vbo, 0, sizeof(Vertex));
+        if (!indices.empty())
+            glCall(glBindBuffer, GL_ELEMENT_ARRAY_BUFFER, ebo);
+    }
+
+    // instancedVao is still bound
+    SetupInstanceAttributes();
+
+    GLState::BindVertexArray(0);
+}
+
+void Mesh::SetupVertexAttributes() {
     glCall(glEnableVertexAttribArray, 0);
-    glCall(glVertexAttribPointer, 0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, position));
+    glCall(glVertexAttribFormat, 0, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, position));
+    glCall(glVertexAttribBinding, 0, VertexBinding);
 
     glCall(glEnableVertexAttribArray, 1);
-    glCall(glVertexAttribPointer, 1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, normal));
+    glCall(glVertexAttribFormat, 1, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, normal));
+    glCall(glVertexAttribBinding, 1, VertexBinding);
 
     glCall(glEnableVertexAttribArray, 2);
-    glCall(glVertexAttribPointer, 2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, texture));
+    glCall(glVertexAttribFormat, 2, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, texture));
+    glCall(glVertexAttribBinding, 2, VertexBinding);
+}
 
-    glCall(glBindBuffer, GL_ARRAY_BUFFER, 0);
-    glCall(glBindVertexArray, 0);
+void Mesh::SetupInstanceAttributes() {
+    // mat4 transform takes locations 3-6, mat3 normal 7-9, transparency 10, light range 11
+    for (GLuint i = 0; i < 4; i++) {
+        glCall(glEnableVertexAttribArray, 3 + i);
+        glCall(glVertexAttribFormat, 3 + i, 4, GL_FLOAT, GL_FALSE, offsetof(Instance, transform) + sizeof(glm::vec4) * i);
+        glCall(glVertexAttribBinding, 3 + i, InstanceBinding);
+    }
+
+    for (GLuint i = 0; i < 3; i++) {
+        glCall(glEnableVertexAttribArray, 7 + i);
+        glCall(glVertexAttribFormat, 7 + i, 3, GL_FLOAT, GL_FALSE, offsetof(Instance, normal) + sizeof(glm::vec3) * i);
+        glCall(glVertexAttribBinding, 7 + i, InstanceBinding);
+    }
+
+    glCall(glEnableVertexAttribArray, 10);
+    glCall(glVertexAttribFormat, 10, 1, GL_FLOAT, GL_FALSE, offsetof(Instance, transparency));
+    glCall(glVertexAttribBinding, 10, InstanceBinding);
+
+    glCall(glEnableVertexAttribArray, 11);
+    glCall(glVertexAttribIFormat, 11, 2, GL_UNSIGNED_INT, offsetof(Instance, lights));
+    glCall(glVertexAttribBinding, 11, InstanceBinding);
+
+    glCall(glVertexBindingDivisor, InstanceBinding, 1);
 }
 
 void Mesh::render(const std::unique_ptr<Shader>& shader) const {
+    bindTextures(*shader);
+    render();
+}
+
+void Mesh::render() const {
+    GLState::BindVertexArray(vao);
+    if (elementCount == 0)
+        glCall(glDrawArrays, mode, 0, vertices.size());
+    else
+        glCall(glDrawElementsBaseVertex, mode, elementCount, GL_UNSIGNED_INT, (GLvoid*)(firstIndex * sizeof(GLuint)), baseVertex);
+}
+
+void Mesh::renderInstanced(const std::unique_ptr<Shader>& shader, GLuint buffer, GLintptr offset, GLsizei count) const {
+    bindTextures(*shader);
+
+    GLState::BindVertexArray(instancedVao);
+    glCall(glBindVertexBuffer, InstanceBinding, buffer, offset, sizeof(Instance));
+    draw(count, 0);
+}
+
+void Mesh::draw(GLsizei instanceCount, GLuint baseInstance) const {
+    if (elementCount == 0)
+        glCall(glDrawArraysInstancedBaseInstance, mode, 0, vertices.size(), instanceCount, baseInstance);
+    else
+        glCall(glDrawElementsInstancedBaseVertexBaseInstance, mode, elementCount, GL_UNSIGNED_INT, (GLvoid*)(firstIndex * sizeof(GLuint)), instanceCount, baseVertex, baseInstance);
+}
+
+uint32_t Mesh::getShaderFeatures() const {
+    return textures.empty() ? 0 : FeatureTexture;
+}
+
+void Mesh::setTextureUniforms(const Shader& shader) const {
     uint8_t diffuseIdx = 0;
     uint8_t specularIdx = 0;
     uint8_t heightIdx = 0;
     uint8_t ambientIdx = 0;
 
-    shader->setUniform("has_texture", !textures.empty());
-
     for (int i = 0; i < textures.size(); i++) {
         const auto& texture = textures[i];
 
-        std::string name;
+        std::string_view prefix;
+        uint32_t index;
         switch (texture->getType()) {
             case aiTextureType_DIFFUSE:
-                name = "diffuse" + std::to_string(diffuseIdx++);
+                prefix = "diffuse";
+                index = diffuseIdx++;
                 break;
             case aiTextureType_SPECULAR:
-                name = "specular" + std::to_string(specularIdx++);
+                prefix = "specular";
+                index = specularIdx++;
                 break;
             case aiTextureType_HEIGHT:
-                name = "height" + std::to_string(heightIdx++);
+                prefix = "height";
+                index = heightIdx++;
                 break;
             case aiTextureType_AMBIENT:
-                name = "ambient" + std::to_string(ambientIdx++);
+                prefix = "ambient";
+                index = ambientIdx++;
                 break;
             default:
                 assert("Unknown texture type");
                 return;
         }
 
-        shader->setUniform(name, i);
-        shader->setUniform("texture_scale", texture->getScale());
-        texture->bind(i);
+        shader.setUniform({ prefix, index }, i);
+        shader.setUniform("texture_scale", texture->getScale());
     }
+}
 
-    render();
+void Mesh::bindTextures(const Shader& shader) const {
+    setTextureUniforms(shader);
 
-    for (const auto& texture : textures) {
-        texture->unbind();
+    for (int i = 0; i < textures.size(); i++) {
+        textures[i]->bind(i);
     }
-    glCall(glActiveTexture, GL_TEXTURE0);
-}
-
-void Mesh::render() const {
-    glCall(glBindVertexArray, vao);
-    if (indices.empty())
-        glCall(glDrawArrays, mode, 0, vertices.size());
-    else
-        glCall(glDrawElements, mode, indices.size(), GL_UNSIGNED_INT, (GLvoid*)0);
-    glCall(glBindVertexArray, 0);
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "vertex.hpp"
+#include "bounds.hpp"
 
 class Shader;
 class Texture;
@@ -16,15 +17,41 @@ public:
 
     void render(const std::unique_ptr<Shader>& shader) const;
     void render() const; // no textures
+    void renderInstanced(const std::unique_ptr<Shader>& shader, GLuint buffer, GLintptr offset, GLsizei count) const;
+
+    uint32_t getShaderFeatures() const; // MainShaderFeature bits the material needs
+    const Bounds& getBounds() const { return bounds; }
+    float getInnerRadius() const { return innerRadius; } // sphere around the origin inside the mesh, 0 unless GL_TRIANGLES enclosing the origin
+
+    static constexpr GLuint VertexBinding = 0;
+    static constexpr GLuint InstanceBinding = 3;
+
+    // Attribute formats for the currently bound vao
+    static void SetupVertexAttributes();
+    static void SetupInstanceAttributes();
 
 private:
-    GLuint vao, vbo, ebo;
+    GLuint vao, instancedVao, vbo, ebo;
     GLenum mode;
+
+    // Element range to draw, offset into the geometry arena when the mesh lives there
+    bool inArena{ false };
+    GLint baseVertex{ 0 };
+    GLuint firstIndex{ 0 };
+    GLsizei elementCount{ 0 };
+    Bounds bounds;
+    float innerRadius{ 0.0f };
+
     std::vector<Vertex> vertices;
     std::vector<GLuint> indices;
     std::vector<std::shared_ptr<Texture>> textures;
 
     void initMesh();
+    void draw(GLsizei instanceCount, GLuint baseInstance) const;
+    void setTextureUniforms(const Shader& shader) const;
+    void bindTextures(const Shader& shader) const;
 
     friend class Model;
+    friend class RenderQueue;
+    friend class GpuCuller;
 };
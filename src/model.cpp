@@ -3,6 +3,7 @@
 #include "texture.hpp"
 #include "mesh.hpp"
 #include "common.hpp"
+#include "profiler.hpp"
 
 #include <assimp/Importer.hpp>
 #include <assimp/Exporter.hpp>
@@ -10,6 +11,8 @@
 #include <assimp/postprocess.h>
 #include <assimp/types.h>
 
+std::unordered_map<std::string, std::weak_ptr<Texture>> Model::TextureCache;
+
 void Model::Create(const std::string& path, const std::unique_ptr<Mesh>& mesh, const std::string& format) {
     Assimp::Exporter exporter;
     const aiScene scene = GenerateScene(mesh);
@@ -18,6 +21,8 @@ void Model::Create(const std::string& path, const std::unique_ptr<Mesh>& mesh, c
 }
 
 std::shared_ptr<Model> Model::Load(const std::filesystem::path& path) {
+    PROFILE_SCOPE("Model::Load");
+
     auto model = std::make_shared<Model>();
 
     Assimp::Importer import;
@@ -30,6 +35,13 @@ std::shared_ptr<Model> Model::Load(const std::filesystem::path& path) {
 
     model->directory = path.parent_path();
     model->processNode(scene, scene->mRootNode);
+
+    std::vector<glm::vec3> positions;
+    for (const auto& mesh : model->meshes) {
+        for (const auto& vertex : mesh->vertices)
+            positions.push_back(vertex.position);
+    }
+    model->bounds = Bounds::FromPoints(positions);
     return model;
 }
 
@@ -118,9 +130,15 @@ std::vector<std::shared_ptr<Texture>> Model::loadTextures(const aiMaterial* mate
                     continue;
                 }
 
-                auto texture = std::make_shared<Texture>(path.string(), true, false);
+                // models sharing a texture file share the texture object too, so their meshes end up with one material
+                auto& cached = TextureCache[path.string()];
+                auto texture = cached.lock();
+                if (!texture) {
+                    texture = std::make_shared<Texture>(path.string(), true, false);
+                    texture->setType(type);
+                    cached = texture;
+                }
                 textures.push_back(texture);
-                texture->setType(type);
                 texturesLoaded.push_back(texture); // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
             }
         } else {
@@ -191,3 +209,18 @@ void Model::render(const std::unique_ptr<Shader>& shader) const {
         mesh->render(shader);
     }
 }
+
+
+void Model::renderInstanced(const std::unique_ptr<Shader>& shader, GLuint buffer, GLintptr offset, GLsizei count) const {
+    for (auto& mesh : meshes) {
+        mesh->renderInstanced(shader, buffer, offset, count);
+    }
+}
+
+float Model::getInnerRadius() const {
+    // Meshes that do not enclose the origin have 0, any sphere inside one of the others is inside the model
+    float radius = 0.0f;
+    for (auto& mesh : meshes)
+        radius = std::max(radius, mesh->getInnerRadius());
+    return radius;
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "bounds.hpp"
+
 class Texture;
 class Mesh;
 
@@ -21,15 +23,22 @@ public:
     static std::shared_ptr<Model> Load(const std::filesystem::path& path);
 
     void render(const std::unique_ptr<Shader>& shader) const;
+    void renderInstanced(const std::unique_ptr<Shader>& shader, GLuint buffer, GLintptr offset, GLsizei count) const;
+
+    const std::vector<std::unique_ptr<Mesh>>& getMeshes() const { return meshes; }
+    const Bounds& getBounds() const { return bounds; } // around every mesh, each has its own for culling them apart
+    float getInnerRadius() const; // largest of the meshes enclosing the origin, 0 when none does
 
 private:
     std::filesystem::path directory;
     std::vector<std::unique_ptr<Mesh>> meshes;
     std::vector<std::shared_ptr<Texture>> texturesLoaded;
+    Bounds bounds;
 
     void processNode(const aiScene* scene, const aiNode* node);
     void processMesh(const aiScene* scene, const aiMesh* mesh);
     std::vector<std::shared_ptr<Texture>> loadTextures(const aiMaterial* material, aiTextureType type);
 
     static aiScene GenerateScene(const std::unique_ptr<Mesh>& mesh);
+    static std::unordered_map<std::string, std::weak_ptr<Texture>> TextureCache;
 };
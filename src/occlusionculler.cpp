@@ -0,0 +1,255 @@
+#include "occlusionculler.hpp"
+#include "jobsystem.hpp"
+#include "profiler.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define OCCLUSION_SSE
+#endif
+
+std::shared_ptr<const OcclusionCuller::Occluder> OcclusionCuller::Sphere(float radius) {
+    // Every point lies on the sphere, so their hull stays inside it
+    constexpr uint32_t Stacks = 6;
+    constexpr uint32_t Slices = 12;
+
+    auto occluder = std::make_shared<Occluder>();
+    auto& points = occluder->parts.emplace_back();
+    points.emplace_back(0.0f, 0.0f, radius);
+    for (uint32_t i = 1; i < Stacks; i++) {
+        float polar = glm::pi<float>() * i / Stacks;
+        for (uint32_t j = 0; j < Slices; j++) {
+            float azimuth = glm::two_pi<float>() * j / Slices;
+            points.emplace_back(radius * std::sin(polar) * std::cos(azimuth), radius * std::sin(polar) * std::sin(azimuth), radius * std::cos(polar));
+        }
+    }
+    points.emplace_back(0.0f, 0.0f, -radius);
+    return occluder;
+}
+
+std::shared_ptr<const OcclusionCuller::Occluder> OcclusionCuller::Torus(float radius, float tubeRadius) {
+    constexpr uint32_t Sides = 16;
+    constexpr uint32_t Rings = 6;
+
+    // One part per straight segment between two cross sections, which cuts inside the main circle, the tube is
+    // thinned by as much
+    float thickness = tubeRadius - radius * (1.0f - std::cos(glm::pi<float>() / Sides));
+    auto occluder = std::make_shared<Occluder>();
+    if (thickness <= 0.0f)
+        return occluder;
+
+    auto ring = [&](uint32_t i, std::vector<glm::vec3>& points) {
+        float around = glm::two_pi<float>() * i / Sides;
+        glm::vec3 outwards{ std::cos(around), std::sin(around), 0.0f };
+        for (uint32_t j = 0; j < Rings; j++) {
+            float across = glm::two_pi<float>() * j / Rings;
+            points.push_back(outwards * (radius + thickness * std::cos(across)) + glm::vec3{ 0.0f, 0.0f, thickness * std::sin(across) });
+        }
+    };
+    for (uint32_t i = 0; i < Sides; i++) {
+        auto& points = occluder->parts.emplace_back();
+        ring(i, points);
+        ring(i + 1, points);
+    }
+    return occluder;
+}
+
+OcclusionCuller::OcclusionCuller() : depth(Width * Height, 1.0f), blocks(BlocksX * BlocksY, 1.0f) {
+}
+
+void OcclusionCuller::begin(const glm::mat4& viewProjection) {
+    this->viewProjection = viewProjection;
+    polygons.clear();
+    outline.clear();
+    for (auto& bin : bins)
+        bin.clear();
+}
+
+void OcclusionCuller::add(const Occluder& occluder, const glm::mat4& transform) {
+    glm::mat4 matrix = viewProjection * transform;
+    for (const auto& part : occluder.parts)
+        addPart(part, matrix);
+}
+
+void OcclusionCuller::rasterize() {
+    PROFILE_SCOPE("occlusion raster");
+
+    JobSystem::ParallelFor(0, TilesX * TilesY, 1, [this](uint32_t first, uint32_t last) {
+        for (uint32_t tile = first; tile < last; tile++)
+            rasterizeTile(tile);
+    });
+}
+
+bool OcclusionCuller::isVisible(const glm::vec3& center, float radius) const {
+    glm::vec2 low{ std::numeric_limits<float>::max() };
+    glm::vec2 high{ std::numeric_limits<float>::lowest() };
+    float nearest = std::numeric_limits<float>::max();
+    for (uint32_t corner = 0; corner < 8; corner++) {
+        glm::vec3 offset{ corner & 1 ? radius : -radius, corner & 2 ? radius : -radius, corner & 4 ? radius : -radius };
+        glm::vec4 clip = viewProjection * glm::vec4{ center + offset, 1.0f };
+
+        // Reaching past the near plane, it could cover any part of the screen, same for bounds too large to project
+        if (!(clip.z >= -clip.w))
+            return true;
+
+        glm::vec3 ndc{ clip / clip.w };
+        low = glm::min(low, glm::vec2{ ndc });
+        high = glm::max(high, glm::vec2{ ndc });
+        nearest = std::min(nearest, ndc.z * 0.5f + 0.5f);
+    }
+
+    // Pixels the box touches, off screen is left to frustum culling
+    auto x0 = static_cast<uint32_t>(glm::clamp(std::floor((low.x * 0.5f + 0.5f) * Width), 0.0f, static_cast<float>(Width)));
+    auto x1 = static_cast<uint32_t>(glm::clamp(std::ceil((high.x * 0.5f + 0.5f) * Width), 0.0f, static_cast<float>(Width)));
+    auto y0 = static_cast<uint32_t>(glm::clamp(std::floor((low.y * 0.5f + 0.5f) * Height), 0.0f, static_cast<float>(Height)));
+    auto y1 = static_cast<uint32_t>(glm::clamp(std::ceil((high.y * 0.5f + 0.5f) * Height), 0.0f, static_cast<float>(Height)));
+    if (x0 >= x1 || y0 >= y1)
+        return true;
+
+    for (uint32_t by = y0 / BlockSize; by <= (y1 - 1) / BlockSize; by++) {
+        for (uint32_t bx = x0 / BlockSize; bx <= (x1 - 1) / BlockSize; bx++) {
+            if (blocks[by * BlocksX + bx] <= nearest)
+                continue;
+
+            // Something in the block is farther, look at the pixels the box actually covers
+            for (uint32_t y = std::max(y0, by * BlockSize); y < std::min(y1, (by + 1) * BlockSize); y++) {
+                for (uint32_t x = std::max(x0, bx * BlockSize); x < std::min(x1, (bx + 1) * BlockSize); x++) {
+                    if (depth[y * Width + x] > nearest)
+                        return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+void OcclusionCuller::addPart(const std::vector<glm::vec3>& points, const glm::mat4& matrix) {
+    projected.clear();
+    for (const auto& point : points) {
+        glm::vec4 clip = matrix * glm::vec4{ point, 1.0f };
+
+        // A part reaching past the near plane is left out rather than clipped
+        if (!(clip.z >= -clip.w) || clip.w <= 0.0f)
+            return;
+
+        glm::vec3 ndc{ clip / clip.w };
+        projected.emplace_back((ndc.x * 0.5f + 0.5f) * Width, (ndc.y * 0.5f + 0.5f) * Height, ndc.z * 0.5f + 0.5f);
+    }
+
+    // Points on the same pixel position keep the farthest depth, the outline can only be as near as that
+    std::sort(projected.begin(), projected.end(), [](const glm::vec3& a, const glm::vec3& b) { return a.x < b.x || (a.x == b.x && a.y < b.y); });
+    size_t unique = 0;
+    for (size_t i = 0; i < projected.size(); i++) {
+        if (unique && projected[unique - 1].x == projected[i].x && projected[unique - 1].y == projected[i].y)
+            projected[unique - 1].z = std::max(projected[unique - 1].z, projected[i].z);
+        else
+            projected[unique++] = projected[i];
+    }
+    projected.resize(unique);
+    if (projected.size() < 3)
+        return;
+
+    // Monotone chain, lower then upper half, counter-clockwise without collinear points
+    auto turn = [](const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) { return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x); };
+    hull.clear();
+    for (int pass = 0; pass < 2; pass++) {
+        size_t start = hull.size();
+        for (size_t k = 0; k < projected.size(); k++) {
+            const auto& point = projected[pass ? projected.size() - 1 - k : k];
+            while (hull.size() >= start + 2 && turn(hull[hull.size() - 2], hull.back(), point) <= 0.0f)
+                hull.pop_back();
+            hull.push_back(point);
+        }
+        hull.pop_back(); // first point of the other half
+    }
+    if (hull.size() < 3)
+        return;
+
+    // The front of a convex part is farthest on its outline, which runs straight between the hull points
+    Polygon polygon{ static_cast<uint32_t>(outline.size()), static_cast<uint32_t>(hull.size()), 0.0f, glm::vec2{ hull[0] }, glm::vec2{ hull[0] } };
+    for (const auto& point : hull) {
+        outline.emplace_back(point);
+        polygon.depth = std::max(polygon.depth, point.z);
+        polygon.low = glm::min(polygon.low, glm::vec2{ point });
+        polygon.high = glm::max(polygon.high, glm::vec2{ point });
+    }
+
+    if (polygon.high.x < 0.0f || polygon.high.y < 0.0f || polygon.low.x >= Width || polygon.low.y >= Height) {
+        outline.resize(polygon.first);
+        return;
+    }
+
+    auto tx0 = static_cast<uint32_t>(std::max(polygon.low.x, 0.0f)) / TileSize;
+    auto ty0 = static_cast<uint32_t>(std::max(polygon.low.y, 0.0f)) / TileSize;
+    auto tx1 = static_cast<uint32_t>(std::min(polygon.high.x, Width - 1.0f)) / TileSize;
+    auto ty1 = static_cast<uint32_t>(std::min(polygon.high.y, Height - 1.0f)) / TileSize;
+
+    auto index = static_cast<uint32_t>(polygons.size());
+    polygons.push_back(polygon);
+    for (uint32_t ty = ty0; ty <= ty1; ty++) {
+        for (uint32_t tx = tx0; tx <= tx1; tx++)
+            bins[ty * TilesX + tx].push_back(index);
+    }
+}
+
+void OcclusionCuller::rasterizeTile(uint32_t tile) {
+    uint32_t left = tile % TilesX * TileSize;
+    uint32_t bottom = tile / TilesX * TileSize;
+
+    for (uint32_t y = bottom; y < bottom + TileSize; y++)
+        std::fill_n(depth.begin() + y * Width + left, TileSize, 1.0f);
+
+    for (uint32_t index : bins[tile]) {
+        const auto& polygon = polygons[index];
+        const glm::vec2* points = outline.data() + polygon.first;
+
+        auto clamp = [](float value, uint32_t low, uint32_t high) {
+            return static_cast<uint32_t>(glm::clamp(value, static_cast<float>(low), static_cast<float>(high)));
+        };
+        uint32_t y0 = clamp(std::floor(polygon.low.y), bottom, bottom + TileSize);
+        uint32_t y1 = clamp(std::ceil(polygon.high.y), bottom, bottom + TileSize);
+
+        for (uint32_t y = y0; y < y1; y++) {
+            // Each edge keeps the pixel centers whose whole pixel lies on its inner side, leaving a span of the row
+            float py = y + 0.5f;
+            float first = left + 0.5f;
+            float last = left + TileSize - 0.5f;
+            for (uint32_t i = 0; i < polygon.count && first <= last; i++) {
+                const auto& from = points[i];
+                const auto& to = points[i + 1 < polygon.count ? i + 1 : 0];
+                float ex = from.y - to.y;
+                float ey = to.x - from.x;
+                float rest = ey * (py - from.y) - ex * from.x - 0.5f * (std::abs(ex) + std::abs(ey));
+                if (ex > 0.0f)
+                    first = std::max(first, -rest / ex);
+                else if (ex < 0.0f)
+                    last = std::min(last, -rest / ex);
+                else if (rest < 0.0f)
+                    last = first - 1.0f;
+            }
+            if (first > last)
+                continue;
+
+            uint32_t x = static_cast<uint32_t>(std::ceil(first - 0.5f));
+            uint32_t end = static_cast<uint32_t>(std::floor(last - 0.5f)) + 1;
+            float* row = depth.data() + y * Width;
+#ifdef OCCLUSION_SSE
+            __m128 z = _mm_set1_ps(polygon.depth);
+            for (; x + 4 <= end; x += 4)
+                _mm_storeu_ps(row + x, _mm_min_ps(_mm_loadu_ps(row + x), z));
+#endif
+            for (; x < end; x++)
+                row[x] = std::min(row[x], polygon.depth);
+        }
+    }
+
+    for (uint32_t by = bottom / BlockSize; by < (bottom + TileSize) / BlockSize; by++) {
+        for (uint32_t bx = left / BlockSize; bx < (left + TileSize) / BlockSize; bx++) {
+            float farthest = 0.0f;
+            for (uint32_t y = by * BlockSize; y < (by + 1) * BlockSize; y++) {
+                for (uint32_t x = bx * BlockSize; x < (bx + 1) * BlockSize; x++)
+                    farthest = std::max(farthest, depth[y * Width + x]);
+            }
+            blocks[by * BlocksX + bx] = farthest;
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+/// @brief Software occlusion culling against a small depth buffer rasterized on the CPU
+/// Occluders are made of convex parts lying inside the geometry they stand for. Each part is projected and drawn as
+/// the convex hull of its points. A pixel is only written when the hull covers it completely, every edge being moved
+/// in by half a pixel's extent, and it gets the farthest depth the part's front surface reaches, which for a convex
+/// part is the largest depth on its outline. Drawing whole parts rather than their triangles keeps the edges between
+/// triangles from leaving cracks. Parts are binned into screen tiles and drawn one tile per job as row spans, four
+/// pixels at a time, and every tile stores the farthest depth of each block for a quick reject. A bounding sphere is
+/// hidden when the nearest corner of its box lies behind the stored depth of every pixel its screen rectangle
+/// touches. No GL involved, so it runs headless.
+class OcclusionCuller {
+public:
+    static constexpr uint32_t Width = 256;
+    static constexpr uint32_t Height = 128;
+    static constexpr uint32_t TileSize = 32; // pixels, one job each
+    static constexpr uint32_t BlockSize = 8;
+
+    static_assert(Width % TileSize == 0 && Height % TileSize == 0 && TileSize % BlockSize == 0);
+
+    // The convex hull of each part's points has to lie inside the geometry
+    struct Occluder {
+        std::vector<std::vector<glm::vec3>> parts;
+    };
+
+    // Convex shapes inside a sphere, or a torus around the z axis, of the given sizes
+    static std::shared_ptr<const Occluder> Sphere(float radius);
+    static std::shared_ptr<const Occluder> Torus(float radius, float tubeRadius);
+
+    OcclusionCuller();
+
+    void begin(const glm::mat4& viewProjection);
+    void add(const Occluder& occluder, const glm::mat4& transform);
+    void rasterize();
+
+    // Safe to call from several threads once rasterize returned
+    bool isVisible(const glm::vec3& center, float radius) const;
+
+    uint32_t getPartCount() const { return static_cast<uint32_t>(polygons.size()); }
+    float getDepth(uint32_t x, uint32_t y) const { return depth[y * Width + x]; } // 0 near to 1 far, bottom row first
+
+private:
+    static constexpr uint32_t TilesX = Width / TileSize;
+    static constexpr uint32_t TilesY = Height / TileSize;
+    static constexpr uint32_t BlocksX = Width / BlockSize;
+    static constexpr uint32_t BlocksY = Height / BlockSize;
+
+    // Counter-clockwise outline in pixels, its points are outline[first, first + count)
+    struct Polygon {
+        uint32_t first, count;
+        float depth;
+        glm::vec2 low, high;
+    };
+
+    glm::mat4 viewProjection{ 1.0f };
+    std::vector<Polygon> polygons;
+    std::vector<glm::vec2> outline;
+    std::array<std::vector<uint32_t>, TilesX * TilesY> bins; // polygons touching each tile
+    std::vector<float> depth;
+    std::vector<float> blocks; // farthest depth per block
+    std::vector<glm::vec3> projected; // screen space points of the part being added, z in [0, 1]
+    std::vector<glm::vec3> hull;
+
+    void addPart(const std::vector<glm::vec3>& points, const glm::mat4& matrix);
+    void rasterizeTile(uint32_t tile);
+};
@@ -1,5 +1,100 @@
 #include "opengl.hpp"
 
+GLFrameStats GLStats::current;
+GLFrameStats GLStats::last;
+std::deque<GLFunctionStats> GLStats::functions;
+
+void GLStats::EndFrame() {
+    last = current;
+    current = {};
+
+    for (auto& function : functions) {
+        function.lastFrameCalls = function.frameCalls;
+        function.frameCalls = 0;
+    }
+}
+
+GLFunctionStats& GLStats::Register(const char* name) {
+    // Several call sites of one function share its counter
+    for (auto& function : functions) {
+        if (std::strcmp(function.name, name) == 0)
+            return function;
+    }
+    return functions.emplace_back(GLFunctionStats{ name });
+}
+
+void GLDebug::Init(Mode requested) {
+    mode = requested;
+    if (mode != Mode::Sync && mode != Mode::Async) {
+        glCall(glDisable, GL_DEBUG_OUTPUT);
+        return;
+    }
+
+    if (!GLAD_GL_VERSION_4_3) {
+        std::cerr << "ERROR: Debug output needs OpenGL 4.3, polling glGetError instead" << std::endl;
+        mode = Mode::Poll;
+        return;
+    }
+
+    glCall(glEnable, GL_DEBUG_OUTPUT);
+    if (mode == Mode::Sync) {
+        glCall(glEnable, GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    } else {
+        glCall(glDisable, GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    }
+
+    glCall(glDebugMessageCallback, Callback, nullptr);
+    glCall(glDebugMessageControl, GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, GL_FALSE);
+}
+
+void APIENTRY GLDebug::Callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* user) {
+    const char* kind;
+    switch (type) {
+        case GL_DEBUG_TYPE_ERROR: kind = "ERROR"; break;
+        case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: kind = "DEPRECATED"; break;
+        case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: kind = "UNDEFINED"; break;
+        case GL_DEBUG_TYPE_PORTABILITY: kind = "PORTABILITY"; break;
+        case GL_DEBUG_TYPE_PERFORMANCE: kind = "PERFORMANCE"; break;
+        default: kind = "OTHER"; break;
+    }
+
+    const char* level;
+    switch (severity) {
+        case GL_DEBUG_SEVERITY_HIGH: level = "high"; break;
+        case GL_DEBUG_SEVERITY_MEDIUM: level = "medium"; break;
+        case GL_DEBUG_SEVERITY_LOW: level = "low"; break;
+        default: level = "notification"; break;
+    }
+
+    std::cerr << "***GL " << kind << "*** [" << level << ", id " << id << "] ";
+
+    // An asynchronous message can arrive on a driver thread, long after the call that caused it
+    if (mode == Mode::Sync && site.file) {
+        std::cerr << "(" << site.file << ": " << site.line << ") ";
+    }
+
+    std::cerr << std::string_view{ message, static_cast<size_t>(length) } << std::endl;
+}
+
+uint64_t GLPixelBytes(GLsizei width, GLsizei height, GLenum format, GLenum type) {
+    uint64_t components;
+    switch (format) {
+        case GL_RED: case GL_DEPTH_COMPONENT: components = 1; break;
+        case GL_RG: components = 2; break;
+        case GL_RGB: case GL_BGR: components = 3; break;
+        default: components = 4; break;
+    }
+
+    uint64_t size;
+    switch (type) {
+        case GL_UNSIGNED_BYTE: case GL_BYTE: size = 1; break;
+        case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT: size = 2; break;
+        default: size = 4; break;
+    }
+
+    return static_cast<uint64_t>(width) * static_cast<uint64_t>(height) * components * size;
+}
+
 bool check_gl_errors(const std::string& filename, uint32_t line) {
     GLenum error = glGetError();
     if (error != GL_NO_ERROR) {
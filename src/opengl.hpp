@@ -2,30 +2,196 @@
 
 /// https://indiegamedev.net/2020/01/17/c-opengl-function-call-wrapping/
 
-template<typename Error, typename Function, typename... Params>
+/// @brief Driver work of one frame, counted in glCallImpl when built with GL_CALL_STATS
+struct GLFrameStats {
+    uint32_t calls{ 0 };
+    uint32_t drawCalls{ 0 };
+    uint32_t dispatches{ 0 };
+    uint32_t programBinds{ 0 };
+    uint32_t vaoBinds{ 0 };
+    uint32_t textureBinds{ 0 };
+    uint32_t uniformUploads{ 0 };
+    uint64_t bufferBytes{ 0 }; // glBufferData / glBufferSubData / glBufferStorage
+    uint64_t textureBytes{ 0 }; // glTexImage2D / glTexSubImage2D
+};
+
+struct GLFunctionStats {
+    const char* name;
+    uint32_t frameCalls{ 0 };
+    uint32_t lastFrameCalls{ 0 };
+    uint64_t totalCalls{ 0 };
+};
+
+enum class GLCallKind { Other, Draw, Dispatch, ProgramBind, VaoBind, TextureBind, Uniform, BufferData, BufferSubData, TexImage2D, TexSubImage2D };
+
+// Resolved from the function name at compile time
+constexpr GLCallKind ClassifyGLCall(std::string_view name) {
+    auto starts = [name](std::string_view prefix) { return name.substr(0, prefix.size()) == prefix; };
+
+    if (starts("glDraw") || starts("glMultiDraw"))
+        return GLCallKind::Draw;
+    if (starts("glDispatchCompute"))
+        return GLCallKind::Dispatch;
+    if (name == "glUseProgram")
+        return GLCallKind::ProgramBind;
+    if (name == "glBindVertexArray")
+        return GLCallKind::VaoBind;
+    if (name == "glBindTexture" || name == "glBindTextures" || name == "glBindTextureUnit")
+        return GLCallKind::TextureBind;
+    if (starts("glUniform") && name != "glUniformBlockBinding")
+        return GLCallKind::Uniform;
+    if (starts("glProgramUniform"))
+        return GLCallKind::Uniform;
+    if (name == "glBufferData" || name == "glBufferStorage" || name == "glNamedBufferData" || name == "glNamedBufferStorage")
+        return GLCallKind::BufferData;
+    if (name == "glBufferSubData" || name == "glNamedBufferSubData")
+        return GLCallKind::BufferSubData;
+    if (name == "glTexImage2D")
+        return GLCallKind::TexImage2D;
+    if (name == "glTexSubImage2D")
+        return GLCallKind::TexSubImage2D;
+    return GLCallKind::Other;
+}
+
+/// @brief Per function and per frame GL call counters
+/// Counting only happens when built with GL_CALL_STATS, otherwise glCall passes an empty policy that compiles away
+/// and the counters stay zero. Counters are plain integers and belong to the thread that owns the context.
+class GLStats {
+public:
+#ifdef GL_CALL_STATS
+    static constexpr bool Enabled = true;
+#else
+    static constexpr bool Enabled = false;
+#endif
+
+    static void EndFrame(); // on the GL thread, once per frame
+    static const GLFrameStats& GetLastFrame() { return last; }
+    static const std::deque<GLFunctionStats>& GetFunctions() { return functions; }
+
+    static GLFunctionStats& Register(const char* name);
+
+    static void Record(GLCallKind kind, GLFunctionStats& function, uint64_t bytes) {
+        current.calls++;
+        function.frameCalls++;
+        function.totalCalls++;
+
+        switch (kind) {
+            case GLCallKind::Draw: current.drawCalls++; break;
+            case GLCallKind::Dispatch: current.dispatches++; break;
+            case GLCallKind::ProgramBind: current.programBinds++; break;
+            case GLCallKind::VaoBind: current.vaoBinds++; break;
+            case GLCallKind::TextureBind: current.textureBinds++; break;
+            case GLCallKind::Uniform: current.uniformUploads++; break;
+            case GLCallKind::BufferData:
+            case GLCallKind::BufferSubData: current.bufferBytes += bytes; break;
+            case GLCallKind::TexImage2D:
+            case GLCallKind::TexSubImage2D: current.textureBytes += bytes; break;
+            default: break;
+        }
+    }
+
+private:
+    static GLFrameStats current;
+    static GLFrameStats last;
+    static std::deque<GLFunctionStats> functions; // stable addresses for the call sites
+};
+
+uint64_t GLPixelBytes(GLsizei width, GLsizei height, GLenum format, GLenum type);
+
+template<GLCallKind Kind, typename... Params>
+uint64_t GLCallBytes(const Params&... params) {
+    auto args = std::forward_as_tuple(params...);
+    if constexpr (Kind == GLCallKind::BufferData)
+        return static_cast<uint64_t>(std::get<1>(args));
+    else if constexpr (Kind == GLCallKind::BufferSubData)
+        return static_cast<uint64_t>(std::get<2>(args));
+    else if constexpr (Kind == GLCallKind::TexImage2D)
+        return GLPixelBytes(std::get<3>(args), std::get<4>(args), std::get<6>(args), std::get<7>(args));
+    else if constexpr (Kind == GLCallKind::TexSubImage2D)
+        return GLPixelBytes(std::get<4>(args), std::get<5>(args), std::get<6>(args), std::get<7>(args));
+    else
+        return 0;
+}
+
+template<GLCallKind Kind>
+struct GLCallCounter {
+    GLFunctionStats& function;
+
+    template<typename... Params>
+    void operator()(const Params&... params) const {
+        GLStats::Record(Kind, function, GLCallBytes<Kind>(params...));
+    }
+};
+
+struct GLNoStats {
+    template<typename... Params>
+    void operator()(const Params&...) const {}
+};
+
+struct GLCallSite {
+    const char* file;
+    uint32_t line;
+};
+
+/// @brief How GL errors are reported in debug builds
+/// The debug callback is preferred: glCallImpl only stores the call site in a thread local, and a synchronous callback
+/// runs inside the failing call so it can report that site. Polling glGetError after every call is kept as an opt-in
+/// because it serialises the driver. It is also the default until Init() is called. Release builds do neither.
+class GLDebug {
+public:
+    enum class Mode { Off, Sync, Async, Poll };
+
+    static void Init(Mode mode); // needs a current context
+    static Mode GetMode() { return mode; }
+    static bool Polling() { return mode == Mode::Poll; }
+
+    static void SetCallSite(const char* file, uint32_t line) {
+        site.file = file;
+        site.line = line;
+    }
+
+private:
+    static inline Mode mode{ Mode::Poll };
+    static inline thread_local GLCallSite site; // zero initialised
+
+    static void APIENTRY Callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* user);
+};
+
+template<typename Error, typename Stats, typename Function, typename... Params>
 auto glCallImpl(const char* filename,
               uint32_t line,
               Error error,
+              Stats stats,
               Function function,
               Params... params)
 -> typename std::enable_if_t<!std::is_same_v<void, decltype(function(params...))>, decltype(function(params...))> {
+    stats(params...);
+#ifndef NDEBUG
+    GLDebug::SetCallSite(filename, line);
+#endif
     auto ret = function(std::forward<Params>(params)...);
 #ifndef NDEBUG
-    error(filename, line);
+    if (GLDebug::Polling())
+        error(filename, line);
 #endif
     return ret;
 }
 
-template<typename Error, typename Function, typename... Params>
+template<typename Error, typename Stats, typename Function, typename... Params>
 auto glCallImpl(const char* filename,
               const uint32_t line,
               Error error,
+              Stats stats,
               Function function,
               Params... params)
 -> typename std::enable_if_t<std::is_same_v<void, decltype(function(params...))>, bool> {
+    stats(params...);
+#ifndef NDEBUG
+    GLDebug::SetCallSite(filename, line);
+#endif
     function(std::forward<Params>(params)...);
 #ifndef NDEBUG
-    return error(filename, line);
+    return GLDebug::Polling() ? error(filename, line) : true;
 #else
     return true;
 #endif
@@ -33,5 +199,12 @@ auto glCallImpl(const char* filename,
 
 bool check_gl_errors(const std::string& filename, uint32_t line);
 
-#define glCall_(function) glCallImpl(__FILE__, __LINE__, check_gl_errors, function)
-#define glCall(function, ...) glCallImpl(__FILE__, __LINE__, check_gl_errors, function, __VA_ARGS__)
+#ifdef GL_CALL_STATS
+// Every call site registers its function once, the lambda gives each expansion its own static
+#define GL_CALL_STATS_POLICY(name) GLCallCounter<ClassifyGLCall(name)>{ []() -> GLFunctionStats& { static GLFunctionStats& stats = GLStats::Register(name); return stats; }() }
+#else
+#define GL_CALL_STATS_POLICY(name) GLNoStats{}
+#endif
+
+#define glCall_(function) glCallImpl(__FILE__, __LINE__, check_gl_errors, GL_CALL_STATS_POLICY(#function), function)
+#define glCall(function, ...) glCallImpl(__FILE__, __LINE__, check_gl_errors, GL_CALL_STATS_POLICY(#function), function, __VA_ARGS__)
@@ -0,0 +1,185 @@
+#include "profiler.hpp"
+#include "opengl.hpp"
+
+std::mutex Profiler::mutex;
+std::map<std::string_view, Profiler::Timings> Profiler::cpuTimings;
+std::map<std::string_view, Profiler::Timings> Profiler::gpuTimings;
+std::vector<Profiler::Event> Profiler::events;
+std::map<uint32_t, std::string> Profiler::threadNames;
+std::atomic<bool> Profiler::capturing{ false };
+std::atomic<uint32_t> Profiler::threadCount{ GpuThread + 1 };
+thread_local uint32_t Profiler::thread{ threadCount++ };
+
+bool Profiler::gpuEnabled{ false };
+std::array<Profiler::GpuFrame, Profiler::GpuLatency> Profiler::gpuFrames;
+uint32_t Profiler::gpuFrame{ 0 };
+int64_t Profiler::gpuOffset{ 0 };
+
+namespace {
+    const auto epoch = std::chrono::steady_clock::now();
+}
+
+int64_t Profiler::Now() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Profiler::Init() {
+    // Line up GPU timestamps with the CPU clock for the trace
+    GLint64 gpuNow;
+    glCall(glGetInteger64v, GL_TIMESTAMP, &gpuNow);
+    gpuOffset = Now() * 1000 - gpuNow;
+    gpuEnabled = true;
+
+    std::lock_guard<std::mutex> lock{ mutex };
+    threadNames[GpuThread] = "GPU";
+}
+
+void Profiler::Shutdown() {
+    for (auto& frame : gpuFrames) {
+        if (!frame.queries.empty())
+            glCall(glDeleteQueries, static_cast<GLsizei>(frame.queries.size()), frame.queries.data());
+        frame = {};
+    }
+    gpuEnabled = false;
+}
+
+void Profiler::SetThreadName(const char* name) {
+    std::lock_guard<std::mutex> lock{ mutex };
+    threadNames[thread] = name;
+}
+
+void Profiler::Record(std::map<std::string_view, Timings>& timings, const char* name, int64_t start, int64_t duration, uint32_t thread) {
+    std::lock_guard<std::mutex> lock{ mutex };
+
+    auto& history = timings[name];
+    history.samples[history.next] = static_cast<float>(duration) / 1000.0f;
+    history.next = (history.next + 1) % HistorySize;
+    history.count = std::min(history.count + 1, HistorySize);
+
+    if (capturing)
+        events.push_back({ name, start, duration, thread });
+}
+
+Profiler::CpuScope::CpuScope(const char* name) : name{name}, start{Now()} {
+}
+
+Profiler::CpuScope::~CpuScope() {
+    Record(cpuTimings, name, start, Now() - start, thread);
+}
+
+Profiler::GpuScope::GpuScope(const char* name) {
+    if (!gpuEnabled)
+        return;
+
+    auto& frame = gpuFrames[gpuFrame % GpuLatency];
+    index = frame.used++;
+
+    if (frame.queries.size() < frame.used * 2) {
+        frame.queries.resize(frame.used * 2);
+        frame.names.resize(frame.used);
+        glCall(glGenQueries, 2, &frame.queries[index * 2]);
+    }
+
+    frame.names[index] = name;
+    glCall(glQueryCounter, frame.queries[index * 2], GL_TIMESTAMP);
+}
+
+Profiler::GpuScope::~GpuScope() {
+    if (!gpuEnabled)
+        return;
+
+    auto& frame = gpuFrames[gpuFrame % GpuLatency];
+    glCall(glQueryCounter, frame.queries[index * 2 + 1], GL_TIMESTAMP);
+}
+
+void Profiler::EndGpuFrame() {
+    if (!gpuEnabled)
+        return;
+
+    // The slot about to be reused was issued GpuLatency frames ago, results that are still not ready are dropped
+    auto& frame = gpuFrames[++gpuFrame % GpuLatency];
+
+    for (uint32_t i = 0; i < frame.used; i++) {
+        GLint available = 0;
+        glCall(glGetQueryObjectiv, frame.queries[i * 2 + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            continue;
+
+        GLuint64 begin, end;
+        glCall(glGetQueryObjectui64v, frame.queries[i * 2], GL_QUERY_RESULT, &begin);
+        glCall(glGetQueryObjectui64v, frame.queries[i * 2 + 1], GL_QUERY_RESULT, &end);
+
+        int64_t start = (static_cast<int64_t>(begin) + gpuOffset) / 1000;
+        Record(gpuTimings, frame.names[i], start, static_cast<int64_t>(end - begin) / 1000, GpuThread);
+    }
+
+    frame.used = 0;
+}
+
+void Profiler::BeginCapture() {
+    std::lock_guard<std::mutex> lock{ mutex };
+    events.clear();
+    capturing = true;
+}
+
+bool Profiler::EndCapture(const std::filesystem::path& path) {
+    std::lock_guard<std::mutex> lock{ mutex };
+    capturing = false;
+
+    std::ofstream file{ path };
+    if (!file) {
+        std::cerr << "ERROR: Could not write trace: \"" << path.string() << "\"" << std::endl;
+        return false;
+    }
+
+    file << "{\"traceEvents\":[\n";
+    bool first = true;
+    for (const auto& [id, name] : threadNames) {
+        file << (first ? "" : ",\n") << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << id << R"(,"args":{"name":")" << name << "\"}}";
+        first = false;
+    }
+    for (const auto& event : events) {
+        file << (first ? "" : ",\n") << R"({"name":")" << event.name << R"(","ph":"X","pid":1,"tid":)" << event.thread
+             << ",\"ts\":" << event.start << ",\"dur\":" << event.duration << "}";
+        first = false;
+    }
+    file << "\n]}\n";
+
+    std::cout << "Wrote " << events.size() << " trace events to " << path.string() << std::endl;
+    events.clear();
+    return true;
+}
+
+std::vector<Profiler::Event> Profiler::StopCapture() {
+    std::lock_guard<std::mutex> lock{ mutex };
+    capturing = false;
+
+    std::vector<Event> captured;
+    captured.swap(events);
+    return captured;
+}
+
+std::vector<Profiler::Summary> Profiler::Report() {
+    std::lock_guard<std::mutex> lock{ mutex };
+
+    std::vector<Summary> report;
+    std::vector<float> sorted;
+
+    auto summarise = [&](const std::map<std::string_view, Timings>& timings, bool gpu) {
+        for (const auto& [name, history] : timings) {
+            if (history.count == 0)
+                continue;
+
+            sorted.assign(history.samples.begin(), history.samples.begin() + history.count);
+            std::sort(sorted.begin(), sorted.end());
+
+            float sum = std::accumulate(sorted.begin(), sorted.end(), 0.0f);
+            size_t p99 = std::min(sorted.size() - 1, sorted.size() * 99 / 100);
+            report.push_back({ name, gpu, sorted.front(), sum / static_cast<float>(sorted.size()), sorted[p99] });
+        }
+    };
+
+    summarise(cpuTimings, false);
+    summarise(gpuTimings, true);
+    return report;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+/// @brief Frame profiler for CPU scopes and GPU timer queries
+/// Every scope keeps a window of recent durations for min/avg/p99 reports. While capturing, scopes are also recorded
+/// as events and written as a Chrome trace that chrome://tracing and ui.perfetto.dev can open.
+/// GPU scopes are timestamp query pairs read back a few frames later, so they never stall the pipeline.
+class Profiler {
+public:
+    struct Summary {
+        std::string_view name;
+        bool gpu;
+        float min; // milliseconds
+        float avg;
+        float p99;
+    };
+
+    struct Event {
+        const char* name;
+        int64_t start; // microseconds
+        int64_t duration;
+        uint32_t thread;
+    };
+
+    static constexpr uint32_t GpuThread = 0;
+
+    class CpuScope {
+    public:
+        explicit CpuScope(const char* name);
+        ~CpuScope();
+
+    private:
+        const char* name;
+        int64_t start;
+    };
+
+    class GpuScope {
+    public:
+        explicit GpuScope(const char* name);
+        ~GpuScope();
+
+    private:
+        uint32_t index;
+    };
+
+    static void Init(); // needs a current context, GPU scopes do nothing before
+    static void Shutdown();
+    static void EndGpuFrame(); // on the GL thread once the frame is submitted
+    static void SetThreadName(const char* name);
+
+    static void BeginCapture();
+    static bool EndCapture(const std::filesystem::path& path);
+    static std::vector<Event> StopCapture(); // hands the events over instead of writing them
+    static bool IsCapturing() { return capturing; }
+
+    static std::vector<Summary> Report();
+
+private:
+    static constexpr size_t HistorySize = 240;
+    static constexpr uint32_t GpuLatency = 4; // frames before queries are read back
+    struct Timings {
+        std::array<float, HistorySize> samples;
+        size_t count{ 0 };
+        size_t next{ 0 };
+    };
+
+    struct GpuFrame {
+        std::vector<GLuint> queries; // begin and end timestamp per scope
+        std::vector<const char*> names;
+        uint32_t used{ 0 };
+    };
+
+    static std::mutex mutex;
+    static std::map<std::string_view, Timings> cpuTimings;
+    static std::map<std::string_view, Timings> gpuTimings;
+    static std::vector<Event> events;
+    static std::map<uint32_t, std::string> threadNames;
+    static std::atomic<bool> capturing;
+    static std::atomic<uint32_t> threadCount;
+    static thread_local uint32_t thread;
+
+    static bool gpuEnabled;
+    static std::array<GpuFrame, GpuLatency> gpuFrames;
+    static uint32_t gpuFrame;
+    static int64_t gpuOffset; // nanoseconds from GPU to CPU clock
+
+    static int64_t Now();
+    static void Record(std::map<std::string_view, Timings>& timings, const char* name, int64_t start, int64_t duration, uint32_t thread);
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(name) Profiler::CpuScope PROFILE_CONCAT(profileScope, __LINE__){ name }
+#define PROFILE_GPU_SCOPE(name) Profiler::GpuScope PROFILE_CONCAT(profileGpuScope, __LINE__){ name }
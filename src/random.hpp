@@ -6,6 +6,8 @@ private:
     static std::mt19937 mt;
 
 public:
+    static void Seed(uint32_t seed) { mt.seed(seed); }
+
     static int IntRange(int rangeStart, int rangeEnd);
     static int IntValue() { return IntRange(0, 1); }
 
@@ -0,0 +1,238 @@
+#include "renderqueue.hpp"
+#include "shader.hpp"
+#include "shadervariants.hpp"
+#include "mesh.hpp"
+#include "model.hpp"
+#include "texture.hpp"
+#include "streambuffer.hpp"
+#include "geometryarena.hpp"
+#include "opengl.hpp"
+#include "glstate.hpp"
+
+static constexpr size_t MaxTextureUnits = 16;
+
+RenderQueue::RenderQueue(StreamBuffer& stream) : stream{stream} {
+}
+
+void RenderQueue::begin(const glm::vec3& position, float range) {
+    eye = position;
+    depthRange = range;
+    packets.clear();
+    stats = {};
+}
+
+void RenderQueue::submit(const std::unique_ptr<Shader>& shader, const Mesh* mesh, const Instance& instance) {
+    packets.push_back({ shader.get(), mesh, instance });
+}
+
+void RenderQueue::submit(const std::unique_ptr<Shader>& shader, const Model* model, const Instance& instance) {
+    for (const auto& mesh : model->getMeshes()) {
+        packets.push_back({ shader.get(), mesh.get(), instance });
+    }
+}
+
+void RenderQueue::submit(ShaderVariants& variants, uint32_t features, const Mesh* mesh, const Instance& instance) {
+    packets.push_back({ &variants.get(features | mesh->getShaderFeatures()), mesh, instance });
+}
+
+void RenderQueue::submit(ShaderVariants& variants, uint32_t features, const Model* model, const Instance& instance) {
+    for (const auto& mesh : model->getMeshes()) {
+        packets.push_back({ &variants.get(features | mesh->getShaderFeatures()), mesh.get(), instance });
+    }
+}
+
+void RenderQueue::renderOpaque() {
+    stats.packets = static_cast<uint32_t>(packets.size());
+    runs.clear();
+    translucentRuns = 0;
+    if (packets.empty())
+        return;
+
+    entries.clear();
+    for (uint32_t i = 0; i < packets.size(); i++) {
+        entries.push_back({ makeKey(packets[i]), i });
+    }
+
+    RadixSort(entries, scratch);
+
+    // Instances are laid out in draw order, so each merged draw reads a contiguous range via base instance
+    instanceAllocation = stream.allocate(static_cast<GLsizeiptr>(entries.size() * sizeof(Instance)), sizeof(glm::vec4));
+    if (!instanceAllocation)
+        return;
+
+    auto* instances = static_cast<Instance*>(instanceAllocation.data);
+    for (size_t i = 0; i < entries.size(); i++) {
+        instances[i] = packets[entries[i].index].instance;
+    }
+
+    // Packets sharing shader and mesh become one instanced run, never across the opaque/translucent boundary
+    for (size_t first = 0; first < entries.size();) {
+        const auto& packet = packets[entries[first].index];
+        bool translucent = entries[first].key >> 63;
+
+        size_t last = first + 1;
+        while (last < entries.size()) {
+            const auto& next = packets[entries[last].index];
+            if (next.shader != packet.shader || next.mesh != packet.mesh || (entries[last].key >> 63) != translucent)
+                break;
+            last++;
+        }
+
+        if (!translucent)
+            translucentRuns = runs.size() + 1;
+        runs.push_back({ packet.shader, packet.mesh, static_cast<GLuint>(first), static_cast<GLsizei>(last - first) });
+        first = last;
+    }
+
+    // Runs of arena meshes only differ by their element range, so they can share one multi-draw
+    commandAllocation = {};
+    if (GeometryArena::Get())
+        commandAllocation = stream.allocate(static_cast<GLsizeiptr>(runs.size() * sizeof(DrawElementsIndirectCommand)), sizeof(GLuint));
+
+    drawRuns(0, translucentRuns);
+}
+
+void RenderQueue::renderTranslucent() {
+    drawRuns(translucentRuns, runs.size());
+}
+
+void RenderQueue::drawRuns(size_t begin, size_t end) {
+    if (begin >= end)
+        return;
+
+    // Whatever was drawn since the last call may have changed the bindings, so nothing is assumed bound
+    if (commandAllocation)
+        GLState::BindBuffer(GL_DRAW_INDIRECT_BUFFER, commandAllocation.buffer);
+
+    const Shader* currentShader = nullptr;
+    const std::vector<std::shared_ptr<Texture>>* currentMaterial = nullptr;
+    GLuint currentVao = 0;
+    std::array<const Texture*, MaxTextureUnits> boundTextures{};
+
+    for (size_t first = begin; first < end;) {
+        const auto& run = runs[first];
+        const auto* mesh = run.mesh;
+
+        size_t last = first + 1;
+        if (mesh->inArena && commandAllocation) {
+            while (last < end) {
+                const auto* next = runs[last].mesh;
+                if (runs[last].shader != run.shader || !next->inArena || next->mode != mesh->mode || next->textures != mesh->textures)
+                    break;
+                last++;
+            }
+        }
+
+        // Still compiling, the draw picks up again once the program linked
+        if (!run.shader->isReady()) {
+            first = last;
+            continue;
+        }
+
+        if (run.shader != currentShader) {
+            run.shader->use();
+            currentShader = run.shader;
+            currentMaterial = nullptr; // sampler uniforms live in the program
+            stats.programBinds++;
+        } else {
+            stats.programBindsSkipped++;
+        }
+
+        if (currentMaterial == nullptr || *currentMaterial != mesh->textures) {
+            mesh->setTextureUniforms(*run.shader);
+            currentMaterial = &mesh->textures;
+        }
+
+        for (size_t i = 0; i < mesh->textures.size() && i < MaxTextureUnits; i++) {
+            const auto* texture = mesh->textures[i].get();
+            if (boundTextures[i] != texture) {
+                texture->bind(static_cast<int>(i));
+                boundTextures[i] = texture;
+                stats.textureBinds++;
+            } else {
+                stats.textureBindsSkipped++;
+            }
+        }
+
+        if (mesh->instancedVao != currentVao) {
+            GLState::BindVertexArray(mesh->instancedVao);
+            glCall(glBindVertexBuffer, Mesh::InstanceBinding, instanceAllocation.buffer, instanceAllocation.offset, sizeof(Instance));
+            currentVao = mesh->instancedVao;
+            stats.vaoBinds++;
+        } else {
+            stats.vaoBindsSkipped++;
+        }
+
+        if (last - first > 1) {
+            auto* command = static_cast<DrawElementsIndirectCommand*>(commandAllocation.data) + first;
+            for (size_t i = first; i < last; i++, command++) {
+                const auto& r = runs[i];
+                *command = { static_cast<GLuint>(r.mesh->elementCount), static_cast<GLuint>(r.count), r.mesh->firstIndex, r.mesh->baseVertex, r.baseInstance };
+            }
+
+            auto offset = commandAllocation.offset + static_cast<GLintptr>(first * sizeof(DrawElementsIndirectCommand));
+            glCall(glMultiDrawElementsIndirect, mesh->mode, GL_UNSIGNED_INT, (GLvoid*)offset, static_cast<GLsizei>(last - first), 0);
+            stats.indirectDraws += static_cast<uint32_t>(last - first);
+        } else {
+            mesh->draw(run.count, run.baseInstance);
+        }
+        stats.drawCalls++;
+
+        first = last;
+    }
+}
+
+uint64_t RenderQueue::makeKey(const Packet& packet) {
+    uint64_t shader = GetId(shaderIds, packet.shader) & 0xFF;
+    uint64_t mesh = GetId(meshIds, packet.mesh) & 0x7FFF;
+
+    size_t hash = packet.mesh->textures.size();
+    for (const auto& texture : packet.mesh->textures) {
+        hash ^= std::hash<const Texture*>{}(texture.get()) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    }
+    auto [it, inserted] = materialIds.try_emplace(hash, static_cast<uint32_t>(materialIds.size()));
+    uint64_t material = it->second & 0xFFFF;
+
+    float distance = glm::distance(eye, glm::vec3{ packet.instance.transform[3] });
+    uint64_t depth = static_cast<uint64_t>(glm::clamp(distance / depthRange, 0.0f, 1.0f) * 0xFFFFFF);
+
+    if (packet.instance.transparency < 1.0f) {
+        // back-to-front, so depth goes first and is inverted
+        return (uint64_t{1} << 63) | ((0xFFFFFF - depth) << 39) | (shader << 31) | (material << 15) | mesh;
+    } else {
+        return (shader << 55) | (material << 39) | (mesh << 24) | depth;
+    }
+}
+
+uint32_t RenderQueue::GetId(std::unordered_map<const void*, uint32_t>& ids, const void* ptr) {
+    auto [it, inserted] = ids.try_emplace(ptr, static_cast<uint32_t>(ids.size()));
+    return it->second;
+}
+
+void RenderQueue::RadixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch) {
+    // LSD radix sort, one byte per pass; passes where every key shares the byte are skipped
+    scratch.resize(entries.size());
+
+    for (uint32_t shift = 0; shift < 64; shift += 8) {
+        std::array<uint32_t, 256> histogram{};
+        for (const auto& entry : entries) {
+            histogram[(entry.key >> shift) & 0xFF]++;
+        }
+
+        if (histogram[(entries[0].key >> shift) & 0xFF] == entries.size())
+            continue;
+
+        uint32_t offset = 0;
+        for (auto& count : histogram) {
+            uint32_t c = count;
+            count = offset;
+            offset += c;
+        }
+
+        for (const auto& entry : entries) {
+            scratch[histogram[(entry.key >> shift) & 0xFF]++] = entry;
+        }
+
+        entries.swap(scratch);
+    }
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "vertex.hpp"
+#include "streambuffer.hpp"
+
+class Shader;
+class Mesh;
+class Model;
+class Texture;
+class ShaderVariants;
+
+/// @brief Collects draw packets for a frame, sorts them by a 64-bit state key and submits them
+/// with as few program, vao and texture changes as possible.
+///
+/// Opaque key:      [63] 0 | [62..55] shader | [54..39] material | [38..24] mesh | [23..0] depth (front-to-back)
+/// Translucent key: [63] 1 | [62..39] depth (back-to-front) | [38..31] shader | [30..15] material | [14..0] mesh
+///
+/// Consecutive packets that share a shader and mesh are merged into one instanced draw, and consecutive
+/// instanced draws of geometry arena meshes with the same material are merged into one multi-draw-indirect call.
+/// Opaque and translucent packets are drawn by separate calls, so other opaque geometry can go in between.
+class RenderQueue {
+public:
+    struct Stats {
+        uint32_t packets{ 0 };
+        uint32_t drawCalls{ 0 };
+        uint32_t indirectDraws{ 0 };
+        uint32_t programBinds{ 0 };
+        uint32_t programBindsSkipped{ 0 };
+        uint32_t vaoBinds{ 0 };
+        uint32_t vaoBindsSkipped{ 0 };
+        uint32_t textureBinds{ 0 };
+        uint32_t textureBindsSkipped{ 0 };
+    };
+
+    RenderQueue(StreamBuffer& stream);
+
+    void begin(const glm::vec3& position, float range);
+    void submit(const std::unique_ptr<Shader>& shader, const Mesh* mesh, const Instance& instance);
+    void submit(const std::unique_ptr<Shader>& shader, const Model* model, const Instance& instance);
+    // Picks the variant per mesh, the frame's features combined with what its material needs
+    void submit(ShaderVariants& variants, uint32_t features, const Mesh* mesh, const Instance& instance);
+    void submit(ShaderVariants& variants, uint32_t features, const Model* model, const Instance& instance);
+    // Sorts and uploads every packet and draws the opaque ones, renderTranslucent draws the rest afterwards
+    void renderOpaque();
+    void renderTranslucent();
+
+    const Stats& getStats() const { return stats; }
+
+private:
+    struct Packet {
+        const Shader* shader;
+        const Mesh* mesh;
+        Instance instance;
+    };
+
+    struct Run {
+        const Shader* shader;
+        const Mesh* mesh;
+        GLuint baseInstance;
+        GLsizei count;
+    };
+
+    struct SortEntry {
+        uint64_t key;
+        uint32_t index;
+    };
+
+    glm::vec3 eye{ 0.0f };
+    float depthRange{ 1.0f };
+
+    std::vector<Packet> packets;
+    std::vector<SortEntry> entries;
+    std::vector<SortEntry> scratch;
+    std::vector<Run> runs;
+    size_t translucentRuns{ 0 }; // index of the first translucent run
+    StreamBuffer::Allocation instanceAllocation;
+    StreamBuffer::Allocation commandAllocation;
+    StreamBuffer& stream;
+    Stats stats;
+
+    // Stable small ids used to build sort keys
+    std::unordered_map<const void*, uint32_t> shaderIds;
+    std::unordered_map<size_t, uint32_t> materialIds;
+    std::unordered_map<const void*, uint32_t> meshIds;
+
+    uint64_t makeKey(const Packet& packet);
+    void drawRuns(size_t begin, size_t end);
+
+    static uint32_t GetId(std::unordered_map<const void*, uint32_t>& ids, const void* ptr);
+    static void RadixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch);
+};
@@ -0,0 +1,56 @@
+#include "rendersnapshot.hpp"
+
+SnapshotQueue::SnapshotQueue(uint32_t depth) {
+    // one snapshot is always owned by the GL thread
+    for (uint32_t i = 0; i < std::max(depth, 1u) + 1; i++) {
+        snapshots.push_back(std::make_unique<RenderSnapshot>());
+        available.push_back(snapshots.back().get());
+    }
+}
+
+RenderSnapshot* SnapshotQueue::acquire() {
+    std::unique_lock<std::mutex> lock{ mutex };
+    changed.wait(lock, [this] { return closed || !available.empty(); });
+    if (closed)
+        return nullptr;
+
+    auto* snapshot = available.front();
+    available.pop_front();
+    snapshot->clear();
+    return snapshot;
+}
+
+void SnapshotQueue::submit(RenderSnapshot* snapshot) {
+    {
+        std::lock_guard<std::mutex> lock{ mutex };
+        ready.push_back(snapshot);
+    }
+    changed.notify_all();
+}
+
+RenderSnapshot* SnapshotQueue::consume() {
+    std::unique_lock<std::mutex> lock{ mutex };
+    changed.wait(lock, [this] { return closed || !ready.empty(); });
+    if (ready.empty())
+        return nullptr;
+
+    auto* snapshot = ready.front();
+    ready.pop_front();
+    return snapshot;
+}
+
+void SnapshotQueue::release(RenderSnapshot* snapshot) {
+    {
+        std::lock_guard<std::mutex> lock{ mutex };
+        available.push_back(snapshot);
+    }
+    changed.notify_all();
+}
+
+void SnapshotQueue::close() {
+    {
+        std::lock_guard<std::mutex> lock{ mutex };
+        closed = true;
+    }
+    changed.notify_all();
+}
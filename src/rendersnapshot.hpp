@@ -0,0 +1,75 @@
+#pragma once
+
+#include "vertex.hpp"
+#include "lights.hpp"
+#include "frustum.hpp"
+
+class Model;
+class Mesh;
+class Font;
+
+/// @brief Everything the GL thread needs to draw one frame
+/// Written by the simulation side from the registry, read by render() without touching simulation state.
+struct RenderSnapshot {
+    struct Text {
+        const Font* font;
+        std::string text;
+        glm::vec2 position;
+        float scale;
+        glm::vec4 color;
+    };
+
+    uint64_t frame{ 0 };
+    glm::ivec2 size{ 0 };
+    glm::mat4 view{ 1.0f };
+    glm::mat4 projection{ 1.0f };
+    glm::mat4 orthographic{ 1.0f };
+    glm::vec3 eye{ 0.0f };
+    Frustum frustum;
+    bool darkMode{ true };
+    bool wireframe{ false };
+
+    std::vector<std::pair<const Model*, Instance>> models; // visible ones only
+    std::vector<std::pair<const Mesh*, Instance>> meshes;
+    std::vector<SpotLight> spotLights;
+    std::vector<PointLight> pointLights;
+    std::vector<uint32_t> objectLights; // lights reaching each instance, ranges given by Instance::lights
+    std::vector<Text> texts;
+
+    void print(const Font& font, std::string text, float x, float y, float scale = 1.0f, const glm::vec4& color = glm::vec4{ 1.0f }) {
+        texts.push_back({ &font, std::move(text), { x, y }, scale, color });
+    }
+
+    void clear() {
+        models.clear();
+        meshes.clear();
+        spotLights.clear();
+        pointLights.clear();
+        objectLights.clear();
+        texts.clear();
+    }
+};
+
+/// @brief Bounded hand-off of snapshots from the simulation to the GL thread
+/// Depth is how many snapshots the simulation may have in flight ahead of the one being drawn:
+/// 1 is plain double buffering with a frame of latency, higher values absorb spikes at the cost of more latency.
+class SnapshotQueue {
+public:
+    explicit SnapshotQueue(uint32_t depth);
+
+    RenderSnapshot* acquire(); // blocks while every snapshot is in flight, null once closed
+    void submit(RenderSnapshot* snapshot);
+
+    RenderSnapshot* consume(); // blocks until a snapshot is ready, null once closed and drained
+    void release(RenderSnapshot* snapshot);
+
+    void close();
+
+private:
+    std::vector<std::unique_ptr<RenderSnapshot>> snapshots;
+    std::deque<RenderSnapshot*> available;
+    std::deque<RenderSnapshot*> ready;
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool closed{ false };
+};
@@ -1,181 +1,439 @@
 #include "shader.hpp"
 #include "opengl.hpp"
+#include "glstate.hpp"
+#include "shadercache.hpp"
 
-Shader::Shader() : programId{glCall_(glCreateProgram)} {
+// glad was generated without GL_KHR_parallel_shader_compile, the ARB version shares the enum
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+using MaxShaderCompilerThreadsProc = void (APIENTRYP)(GLuint count);
+
+Shader::Shader() {
+    instances.push_back(this);
 }
 
 Shader::~Shader() {
+    instances.erase(std::remove(instances.begin(), instances.end(), this), instances.end());
+
+    if (pending) {
+        for (auto shaderId : pending->shaderIds)
+            glCall(glDeleteShader, shaderId);
+        glCall(glDeleteProgram, pending->program);
+    }
+
+    GLState::ForgetProgram(programId);
     glCall(glDeleteProgram, programId);
 }
 
 void Shader::use() const {
-    glCall(glUseProgram, programId);
+    GLState::UseProgram(programId);
 }
 
 void Shader::unuse() const {
-    glCall(glUseProgram, 0);
+    GLState::UseProgram(0);
+}
+
+void Shader::define(std::string_view name, std::string_view value) {
+    defines += "#define ";
+    defines += name;
+    defines += ' ';
+    defines += value;
+    defines += '\n';
+}
+
+std::vector<Shader::Stage> Shader::MakeStages(const std::string& vertexPath, const std::string& fragmentPath, const std::string& tessControlPath, const std::string& tessEvalPath) {
+    std::vector<Stage> stages{ { GL_VERTEX_SHADER, vertexPath }, { GL_FRAGMENT_SHADER, fragmentPath } };
+
+    if (!tessControlPath.empty())
+        stages.push_back({ GL_TESS_CONTROL_SHADER, tessControlPath });
+
+    if (!tessEvalPath.empty())
+        stages.push_back({ GL_TESS_EVALUATION_SHADER, tessEvalPath });
+
+    return stages;
+}
+
+bool Shader::link(const std::string& vertexPath, const std::string& fragmentPath, const std::string& tessControlPath, const std::string& tessEvalPath) {
+    stages = MakeStages(vertexPath, fragmentPath, tessControlPath, tessEvalPath);
+    start();
+    finish();
+    return isReady();
+}
+
+bool Shader::link(const std::string& computePath) {
+    stages = { { GL_COMPUTE_SHADER, computePath } };
+    start();
+    finish();
+    return isReady();
+}
+
+void Shader::linkAsync(const std::string& vertexPath, const std::string& fragmentPath, const std::string& tessControlPath, const std::string& tessEvalPath) {
+    stages = MakeStages(vertexPath, fragmentPath, tessControlPath, tessEvalPath);
+    start();
+    if (!async)
+        finish();
+}
+
+void Shader::linkAsync(const std::string& computePath) {
+    stages = { { GL_COMPUTE_SHADER, computePath } };
+    start();
+    if (!async)
+        finish();
+}
+
+void Shader::Update() {
+    for (auto* shader : instances)
+        shader->poll();
+}
+
+void Shader::Reload(const std::filesystem::path& file) {
+    for (auto* shader : instances) {
+        if (!shader->uses(file))
+            continue;
+
+        // A newer edit supersedes a build that is still in flight
+        if (shader->pending) {
+            for (auto shaderId : shader->pending->shaderIds)
+                glCall(glDeleteShader, shaderId);
+            glCall(glDeleteProgram, shader->pending->program);
+            shader->pending.reset();
+        }
+
+        std::cout << "Reloading shader: " << file.string() << std::endl;
+        shader->start();
+        if (!async)
+            shader->finish();
+    }
+}
+
+uint32_t Shader::GetPendingCount() {
+    return static_cast<uint32_t>(std::count_if(instances.begin(), instances.end(), [](const Shader* shader) { return shader->isPending(); }));
+}
+
+bool Shader::ParallelCompile() {
+    static const bool supported = [] {
+        GLint count = 0;
+        glCall(glGetIntegerv, GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; i++) {
+            std::string_view name{ reinterpret_cast<const char*>(glCall(glGetStringi, GL_EXTENSIONS, static_cast<GLuint>(i))) };
+            const char* proc = name == "GL_KHR_parallel_shader_compile" ? "glMaxShaderCompilerThreadsKHR"
+                             : name == "GL_ARB_parallel_shader_compile" ? "glMaxShaderCompilerThreadsARB"
+                             : nullptr;
+            if (!proc)
+                continue;
+
+            // Let the driver decide how many threads it compiles on
+            if (auto maxThreads = reinterpret_cast<MaxShaderCompilerThreadsProc>(glfwGetProcAddress(proc)))
+                glCall(maxThreads, 0xFFFFFFFFu);
+            return true;
+        }
+        return false;
+    }();
+    return supported;
 }
 
-bool Shader::link(const std::string& vertexPath, const std::string& fragmentPath, const std::string& tessControlPath, const std::string& tessEvalPath) const {
-    std::vector<GLuint> shaderIds; // for cleanup
+bool Shader::uses(const std::filesystem::path& file) const {
+    auto normal = file.lexically_normal();
+    return std::any_of(stages.begin(), stages.end(), [&](const Stage& stage) { return std::filesystem::path{ stage.path }.lexically_normal() == normal; });
+}
 
-    bool success;
+void Shader::start() {
+    ParallelCompile(); // hands the driver its compiler threads before the first compile
+
+    std::vector<std::string> sources;
+    for (const auto& stage : stages) {
+        auto& source = sources.emplace_back(ReadFile(stage.path));
+
+        // The defines become part of the source, so every variant gets its own cache entry
+        if (!defines.empty()) {
+            size_t position = 0;
+            if (auto version = source.find("#version"); version != std::string::npos) {
+                auto end = source.find('\n', version);
+                if (end == std::string::npos)
+                    end = (source += '\n').size() - 1;
+                position = end + 1;
+            }
+            source.insert(position, defines);
+        }
+    }
 
-    shaderIds.push_back(createShader(ReadFile(vertexPath), GL_VERTEX_SHADER, success));
-    if (!success) return false;
+    uint64_t key = ShaderCache::DriverKey();
+    for (size_t i = 0; i < stages.size(); i++) {
+        key = ShaderCache::Hash(std::to_string(stages[i].type), key);
+        key = ShaderCache::Hash(sources[i], key);
+    }
 
-    shaderIds.push_back(createShader(ReadFile(fragmentPath), GL_FRAGMENT_SHADER, success));
-    if (!success) return false;
+    GLuint program = glCall_(glCreateProgram);
 
-    if (!tessControlPath.empty()) {
-        shaderIds.push_back(createShader(ReadFile(tessControlPath), GL_TESS_CONTROL_SHADER, success));
-        if (!success) return false;
+    // A cached binary is loaded right away, there is nothing left to wait for
+    if (ShaderCache::Load(program, key)) {
+        pending = Build{ program, {}, key, true };
+        finish();
+        return;
     }
 
-    if (!tessEvalPath.empty()) {
-        shaderIds.push_back(createShader(ReadFile(tessEvalPath), GL_TESS_EVALUATION_SHADER, success));
-        if (!success) return false;
+    pending = Build{ program, {}, key, false };
+    for (size_t i = 0; i < stages.size(); i++) {
+        GLuint shaderId = createShader(sources[i], stages[i].type, program);
+        if (shaderId)
+            pending->shaderIds.push_back(shaderId);
     }
 
-    glCall(glLinkProgram, programId);
+    if (ShaderCache::Enabled())
+        glCall(glProgramParameteri, program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+    glCall(glLinkProgram, program);
+}
+
+bool Shader::poll() {
+    if (!pending)
+        return true;
+
+    if (async && ParallelCompile()) {
+        GLint done = GL_FALSE;
+        glCall(glGetProgramiv, pending->program, GL_COMPLETION_STATUS_KHR, &done);
+        if (!done)
+            return false;
+    }
+
+    finish();
+    return true;
+}
+
+void Shader::finish() {
+    if (!pending)
+        return;
+
+    Build build = std::move(*pending);
+    pending.reset();
+
+    bool success = build.cached || CheckProgram(build.program, GL_LINK_STATUS, "Linking");
+    if (!build.cached && !success) {
+        // The link log rarely says more than "a stage failed", so show the compile logs
+        for (auto shaderId : build.shaderIds)
+            CheckShader(shaderId);
+    }
+
+    for (auto shaderId : build.shaderIds) {
+        glCall(glDetachShader, build.program, shaderId);
+        glCall(glDeleteShader, shaderId);
+    }
 
 #ifndef NDEBUG
-    GLint status;
+    // Validation judges the program against the current GL state, such as samplers still sharing unit 0, so a
+    // failure is only reported and the program is used anyway
+    if (success)
+        CheckProgram(build.program, GL_VALIDATE_STATUS, "Validating");
+#endif
 
-    glCall(glGetProgramiv, programId, GL_LINK_STATUS, &status);
-    if (!status) {
+    if (!success) {
+        std::cerr << "ERROR: Building " << stages.back().path << (isReady() ? " failed, keeping the previous program" : " failed") << std::endl;
+        glCall(glDeleteProgram, build.program);
+        return;
+    }
+
+    if (!build.cached)
+        ShaderCache::Store(build.program, build.key);
+
+    if (programId) {
+        GLState::ForgetProgram(programId);
+        glCall(glDeleteProgram, programId);
+    }
+
+    programId = build.program;
+    generation++;
+    reflect();
+}
+
+bool Shader::CheckProgram(GLuint program, GLenum status, const char* action) {
+    if (status == GL_VALIDATE_STATUS)
+        glCall(glValidateProgram, program);
+
+    GLint result;
+    glCall(glGetProgramiv, program, status, &result);
+    if (!result) {
         GLint length;
-        glCall(glGetProgramiv, programId, GL_INFO_LOG_LENGTH, &length);
+        glCall(glGetProgramiv, program, GL_INFO_LOG_LENGTH, &length);
         std::string info(length, ' ');
-        glCall(glGetProgramInfoLog, programId, info.length(), &length, info.data());
-        std::cerr << "ERROR: Linking Program: " << std::endl;
+        glCall(glGetProgramInfoLog, program, info.length(), &length, info.data());
+        std::cerr << "ERROR: " << action << " Program: " << std::endl;
         std::cerr << info << std::endl;
         return false;
     }
-#endif
-
-    for (auto shaderId : shaderIds) {
-        glCall(glDetachShader, programId, shaderId);
-    }
-
-#ifndef NDEBUG
-    glCall(glValidateProgram, programId);
+    return true;
+}
 
-    glCall(glGetProgramiv, programId, GL_VALIDATE_STATUS, &status);
+bool Shader::CheckShader(GLuint shaderId) {
+    GLint status, shaderType;
+    glCall(glGetShaderiv, shaderId, GL_COMPILE_STATUS, &status);
     if (!status) {
         GLint length;
-        glCall(glGetProgramiv, programId, GL_INFO_LOG_LENGTH, &length);
+        glCall(glGetShaderiv, shaderId, GL_INFO_LOG_LENGTH, &length);
         std::string info(length, ' ');
-        glCall(glGetProgramInfoLog, programId, info.length(), &length, info.data());
-        std::cerr << "ERROR: Validating Program: " << std::endl;
+        glCall(glGetShaderInfoLog, shaderId, info.length(), &length, info.data());
+        glCall(glGetShaderiv, shaderId, GL_SHADER_TYPE, &shaderType);
+        std::cerr << "ERROR: Compiling Shader " << StageName(static_cast<GLenum>(shaderType)) << ": " << std::endl;
         std::cerr << info << std::endl;
         return false;
     }
-#endif
-
     return true;
 }
 
-GLuint Shader::createShader(const std::string& shaderCode, GLenum shaderType, bool& success) const {
+void Shader::reflect() {
+    uniforms.clear();
+    blocks.clear();
+    missing.clear();
+
+    GLint count = 0;
+    glCall(glGetProgramInterfaceiv, programId, GL_UNIFORM, GL_ACTIVE_RESOURCES, &count);
+
+    const GLenum properties[] = { GL_NAME_LENGTH, GL_ARRAY_SIZE, GL_LOCATION, GL_BLOCK_INDEX };
+    for (GLint i = 0; i < count; i++) {
+        GLint values[4];
+        glCall(glGetProgramResourceiv, programId, GL_UNIFORM, i, 4, properties, 4, nullptr, values);
+        if (values[3] != -1)
+            continue; // block members are set through their buffer
+
+        std::string name(values[0], '\0');
+        glCall(glGetProgramResourceName, programId, GL_UNIFORM, i, values[0], nullptr, name.data());
+        name.pop_back(); // the length counts the terminator
+
+        // Arrays are reported by their first element, every element is looked up on its own
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) {
+            auto base = name.substr(0, name.size() - 3);
+            addUniform(base, values[2]);
+            for (GLint element = 0; element < values[1]; element++) {
+                auto elementName = base + "[" + std::to_string(element) + "]";
+                addUniform(elementName, glCall(glGetUniformLocation, programId, elementName.c_str()));
+            }
+        } else {
+            addUniform(name, values[2]);
+        }
+    }
+
+    for (GLenum interface : { GL_UNIFORM_BLOCK, GL_SHADER_STORAGE_BLOCK }) {
+        glCall(glGetProgramInterfaceiv, programId, interface, GL_ACTIVE_RESOURCES, &count);
+        for (GLint i = 0; i < count; i++) {
+            GLint length;
+            const GLenum property = GL_NAME_LENGTH;
+            glCall(glGetProgramResourceiv, programId, interface, i, 1, &property, 1, nullptr, &length);
+
+            std::string name(length, '\0');
+            glCall(glGetProgramResourceName, programId, interface, i, length, nullptr, name.data());
+            name.pop_back();
+
+            blocks.emplace(UniformHandle::Hash(name), static_cast<GLuint>(i));
+        }
+    }
+}
+
+void Shader::addUniform(const std::string& name, GLint location) {
+    auto [it, inserted] = uniforms.emplace(UniformHandle::Hash(name), location);
+    if (!inserted && it->second != location) {
+        std::cerr << "ERROR: Uniform name hash collision: " << name << std::endl;
+    }
+}
+
+GLuint Shader::createShader(const std::string& shaderCode, GLenum shaderType, GLuint program) const {
     GLuint shaderId = glCall(glCreateShader, shaderType);
     if (!shaderId) {
-        std::cerr << "ERROR: creating shader. Type: ";
-        switch (shaderType) {
-            case GL_FRAGMENT_SHADER:
-                std::cerr << "GL_FRAGMENT_SHADER";
-                break;
-            case GL_VERTEX_SHADER:
-                std::cerr << "GL_VERTEX_SHADER";
-                break;
-            case GL_TESS_CONTROL_SHADER:
-                std::cerr << "GL_TESS_CONTROL_SHADER";
-                break;
-            case GL_TESS_EVALUATION_SHADER:
-                std::cerr << "GL_TESS_EVALUATION_SHADER";
-                break;
-            default:
-                std::cerr << "UNKNOWN GL SHADER";
-                break;
-        }
-        std::cerr << std::endl;
-        success = false;
+        std::cerr << "ERROR: creating shader. Type: " << StageName(shaderType) << std::endl;
         return shaderId;
     }
 
+    // The compile status is only asked for once linking failed, asking earlier waits for the compiler
     const GLchar* code = shaderCode.c_str();
     glCall(glShaderSource, shaderId, 1, &code, nullptr);
     glCall(glCompileShader, shaderId);
+    glCall(glAttachShader, program, shaderId);
+    return shaderId;
+}
 
-#ifndef NDEBUG
-    GLint status;
-    glCall(glGetShaderiv, shaderId, GL_COMPILE_STATUS, &status);
-    if (!status) {
-        GLint length;
-        glCall(glGetShaderiv, shaderId, GL_INFO_LOG_LENGTH, &length);
-        std::string info(length, ' ');
-        glCall(glGetShaderInfoLog, shaderId, info.length(), &length, info.data());
-        std::cerr << "ERROR: Compiling Shader: " << std::endl;
-        std::cerr << info << std::endl;
-        success = false;
-        return shaderId;
+const char* Shader::StageName(GLenum shaderType) {
+    switch (shaderType) {
+        case GL_FRAGMENT_SHADER: return "GL_FRAGMENT_SHADER";
+        case GL_VERTEX_SHADER: return "GL_VERTEX_SHADER";
+        case GL_TESS_CONTROL_SHADER: return "GL_TESS_CONTROL_SHADER";
+        case GL_TESS_EVALUATION_SHADER: return "GL_TESS_EVALUATION_SHADER";
+        case GL_COMPUTE_SHADER: return "GL_COMPUTE_SHADER";
+        default: return "UNKNOWN GL SHADER";
     }
-#endif
+}
 
-    glCall(glAttachShader, programId, shaderId);
-    success = true;
-    return shaderId;
+void Shader::setUniform(UniformHandle uniform, int value) const {
+    glCall(glUniform1i, findUniform(uniform), value);
 }
 
-void Shader::setUniform(const std::string& name, int value) const {
-    glCall(glUniform1i, findUniform(name), value);
+void Shader::setUniform(UniformHandle uniform, float value) const {
+    glCall(glUniform1f, findUniform(uniform), value);
 }
 
-void Shader::setUniform(const std::string& name, float value) const {
-    glCall(glUniform1f, findUniform(name), value);
+void Shader::setUniform(UniformHandle uniform, const glm::vec2& value) const {
+    glCall(glUniform2f, findUniform(uniform), value.x, value.y);
 }
 
-void Shader::setUniform(const std::string& name, const glm::vec2& value) const {
-    glCall(glUniform2f, findUniform(name), value.x, value.y);
+void Shader::setUniform(UniformHandle uniform, const glm::vec3& value) const {
+    glCall(glUniform3f, findUniform(uniform), value.x, value.y, value.z);
 }
 
-void Shader::setUniform(const std::string& name, const glm::vec3& value) const {
-    glCall(glUniform3f, findUniform(name), value.x, value.y, value.z);
+void Shader::setUniform(UniformHandle uniform, const glm::vec4& value) const {
+    glCall(glUniform4f, findUniform(uniform), value.x, value.y, value.z, value.w);
 }
 
-void Shader::setUniform(const std::string& name, const glm::vec4& value) const {
-    glCall(glUniform4f, findUniform(name), value.x, value.y, value.z, value.w);
+void Shader::setUniform(UniformHandle uniform, const glm::mat2& value) const {
+    glCall(glUniformMatrix2fv, findUniform(uniform), 1, GL_FALSE, glm::value_ptr(value));
 }
 
-void Shader::setUniform(const std::string& name, const glm::mat2& value) const {
-    glCall(glUniformMatrix2fv, findUniform(name), 1, GL_FALSE, glm::value_ptr(value));
+void Shader::setUniform(UniformHandle uniform, const glm::mat2& value, int count) const {
+    glCall(glUniformMatrix2fv, findUniform(uniform), count, GL_FALSE, glm::value_ptr(value));
 }
 
-void Shader::setUniform(const std::string& name, const glm::mat2& value, int count) const {
-    glCall(glUniformMatrix2fv, findUniform(name), count, GL_FALSE, glm::value_ptr(value));
+void Shader::setUniform(UniformHandle uniform, const glm::mat3& value) const {
+    glCall(glUniformMatrix3fv, findUniform(uniform), 1, GL_FALSE, glm::value_ptr(value));
 }
 
-void Shader::setUniform(const std::string& name, const glm::mat3& value) const {
-    glCall(glUniformMatrix3fv, findUniform(name), 1, GL_FALSE, glm::value_ptr(value));
+void Shader::setUniform(UniformHandle uniform, const glm::mat3& value, int count) const {
+    glCall(glUniformMatrix3fv, findUniform(uniform), count, GL_FALSE, glm::value_ptr(value));
 }
 
-void Shader::setUniform(const std::string& name, const glm::mat3& value, int count) const {
-    glCall(glUniformMatrix3fv, findUniform(name), count, GL_FALSE, glm::value_ptr(value));
+void Shader::setUniform(UniformHandle uniform, const glm::mat4& value) const {
+    glCall(glUniformMatrix4fv, findUniform(uniform), 1, GL_FALSE, glm::value_ptr(value));
 }
 
-void Shader::setUniform(const std::string& name, const glm::mat4& value) const {
-    glCall(glUniformMatrix4fv, findUniform(name), 1, GL_FALSE, glm::value_ptr(value));
+void Shader::setUniform(UniformHandle uniform, const glm::mat4& value, int count) const {
+    glCall(glUniformMatrix4fv, findUniform(uniform), count, GL_FALSE, glm::value_ptr(value));
 }
 
-void Shader::setUniform(const std::string& name, const glm::mat4& value, int count) const {
-    glCall(glUniformMatrix4fv, findUniform(name), count, GL_FALSE, glm::value_ptr(value));
+GLint Shader::findUniform(UniformHandle uniform) const {
+    if (!isReady())
+        return -1; // nothing reflected yet
+
+    if (auto it = uniforms.find(uniform.hash); it != uniforms.end())
+        return it->second;
+
+    // Inactive uniforms stay at -1, which GL silently ignores
+    if (missing.insert(uniform.hash).second) {
+        std::cerr << "ERROR: Could not find uniform: " << uniform.name;
+        if (uniform.index >= 0)
+            std::cerr << uniform.index << uniform.suffix;
+        std::cerr << std::endl;
+    }
+    return -1;
 }
 
-GLint Shader::findUniform(const std::string& name) const {
-    GLint uniformLocation = glCall(glGetUniformLocation, programId, name.c_str());
-    if (uniformLocation < 0) {
-        std::cerr << "ERROR: Could not find uniform: " << name << std::endl;
+GLuint Shader::findBlock(UniformHandle block) const {
+    if (!isReady())
+        return GL_INVALID_INDEX;
+
+    if (auto it = blocks.find(block.hash); it != blocks.end())
+        return it->second;
+
+    if (missing.insert(block.hash).second) {
+        std::cerr << "ERROR: Could not find block: " << block.name << std::endl;
     }
-    return uniformLocation;
+    return GL_INVALID_INDEX;
 }
 
 std::string Shader::ReadFile(const std::string& path) {
@@ -1,34 +1,135 @@
 #pragma once
 
+/// @brief Uniform or block name reduced to a 32-bit FNV-1a hash
+/// String literals go through a constexpr constructor, C++17 has no consteval, so the hash is only folded at compile
+/// time by the optimizer or when the handle is a constexpr variable. Indexed names like "gPointLights[3].Position" are
+/// hashed piecewise so the hot path never builds a string. The views are only kept to name a missing uniform and must outlive the call.
+struct UniformHandle {
+    uint32_t hash;
+    std::string_view name;
+    std::string_view suffix;
+    int32_t index{ -1 };
+
+    template<size_t N>
+    constexpr UniformHandle(const char (&name)[N]) : UniformHandle{ std::string_view{ name, N - 1 } } {}
+    UniformHandle(const std::string& name) : UniformHandle{ std::string_view{ name } } {}
+    constexpr explicit UniformHandle(std::string_view name) : hash{ Hash(name) }, name{ name } {}
+
+    constexpr UniformHandle(std::string_view prefix, uint32_t index, std::string_view suffix = {})
+        : hash{ Hash(suffix, Hash(index, Hash(prefix))) }, name{ prefix }, suffix{ suffix }, index{ static_cast<int32_t>(index) } {}
+
+    static constexpr uint32_t Offset = 2166136261u;
+
+    static constexpr uint32_t Hash(std::string_view text, uint32_t hash = Offset) {
+        for (char c : text)
+            hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+        return hash;
+    }
+
+    static constexpr uint32_t Hash(uint32_t number, uint32_t hash) {
+        char digits[10]{};
+        int count = 0;
+        do {
+            digits[count++] = static_cast<char>('0' + number % 10);
+            number /= 10;
+        } while (number > 0);
+        while (count > 0)
+            hash = (hash ^ static_cast<uint8_t>(digits[--count])) * 16777619u;
+        return hash;
+    }
+};
+
+/// @brief Linked program whose sources are compiled and linked without blocking
+/// linkAsync only issues the work. With GL_KHR_parallel_shader_compile the driver finishes it on its own threads and
+/// Update() picks the program up once it reports completion. Without the extension Update() just finishes it.
+/// A rebuild (Reload after a source changed) keeps drawing with the previous program until the new one linked,
+/// a failed build leaves it in place. getGeneration() changes whenever a new program was swapped in, any uniforms
+/// set on the old program have to be set again. All of this happens on the GL thread.
 class Shader {
 public:
     Shader();
     ~Shader();
 
-    void setUniform(const std::string& name, int value) const;
-    void setUniform(const std::string& name, float value) const;
-    void setUniform(const std::string& name, const glm::vec2& value) const;
-    void setUniform(const std::string& name, const glm::vec3& value) const;
-    void setUniform(const std::string& name, const glm::vec4& value) const;
-    void setUniform(const std::string& name, const glm::mat2& value) const;
-    void setUniform(const std::string& name, const glm::mat2& value, int count) const;
-    void setUniform(const std::string& name, const glm::mat3& value) const;
-    void setUniform(const std::string& name, const glm::mat3& value, int count) const;
-    void setUniform(const std::string& name, const glm::mat4& value) const;
-    void setUniform(const std::string& name, const glm::mat4& value, int count) const;
+    void setUniform(UniformHandle uniform, int value) const;
+    void setUniform(UniformHandle uniform, float value) const;
+    void setUniform(UniformHandle uniform, const glm::vec2& value) const;
+    void setUniform(UniformHandle uniform, const glm::vec3& value) const;
+    void setUniform(UniformHandle uniform, const glm::vec4& value) const;
+    void setUniform(UniformHandle uniform, const glm::mat2& value) const;
+    void setUniform(UniformHandle uniform, const glm::mat2& value, int count) const;
+    void setUniform(UniformHandle uniform, const glm::mat3& value) const;
+    void setUniform(UniformHandle uniform, const glm::mat3& value, int count) const;
+    void setUniform(UniformHandle uniform, const glm::mat4& value) const;
+    void setUniform(UniformHandle uniform, const glm::mat4& value, int count) const;
+
+    void define(std::string_view name, std::string_view value = "1"); // before link, injected below #version
 
+    // Blocks until the program is linked
     bool link(const std::string& vertexPath,
               const std::string& fragmentPath,
               const std::string& tessControlPath = "",
-              const std::string& tessEvalPath = "") const;
+              const std::string& tessEvalPath = "");
+    bool link(const std::string& computePath);
+
+    // Returns right away, the program is usable once isReady()
+    void linkAsync(const std::string& vertexPath,
+                   const std::string& fragmentPath,
+                   const std::string& tessControlPath = "",
+                   const std::string& tessEvalPath = "");
+    void linkAsync(const std::string& computePath);
+
+    bool isReady() const { return programId != 0; }
+    bool isPending() const { return pending.has_value(); }
+    uint32_t getGeneration() const { return generation; }
+
+    GLint findUniform(UniformHandle uniform) const;
+    GLuint findBlock(UniformHandle block) const; // uniform or shader storage block index, GL_INVALID_INDEX if inactive
 
     void use() const;
     void unuse() const;
 
+    static void Update(); // once per frame, swaps in the programs that finished linking
+    static void Reload(const std::filesystem::path& file); // rebuilds every program using the file
+    static void SetAsync(bool enabled) { async = enabled; } // off makes linkAsync and Reload block
+    static bool ParallelCompile(); // GL_KHR/ARB_parallel_shader_compile is available
+    static uint32_t GetPendingCount();
+
 private:
-    GLuint programId;
+    struct Stage {
+        GLenum type;
+        std::string path;
+    };
+
+    struct Build {
+        GLuint program;
+        std::vector<GLuint> shaderIds;
+        uint64_t key;
+        bool cached;
+    };
+
+    GLuint programId{ 0 }; // 0 until the first build linked
+    std::optional<Build> pending;
+    uint32_t generation{ 0 };
+    std::vector<Stage> stages;
+    std::string defines;
+    std::unordered_map<uint32_t, GLint> uniforms; // reflected after linking, keyed by UniformHandle::hash
+    std::unordered_map<uint32_t, GLuint> blocks;
+    mutable std::unordered_set<uint32_t> missing; // reported once
+
+    static inline std::vector<Shader*> instances;
+    static inline bool async{ true };
 
-    GLint findUniform(const std::string& name) const;
-    GLuint createShader(const std::string& shaderCode, GLenum shaderType, bool& success) const;
+    static std::vector<Stage> MakeStages(const std::string& vertexPath, const std::string& fragmentPath,
+                                         const std::string& tessControlPath, const std::string& tessEvalPath);
+    void start(); // issues compile and link of the current stages
+    bool poll();  // true once nothing is pending anymore
+    void finish();
+    bool uses(const std::filesystem::path& file) const;
+    void reflect();
+    void addUniform(const std::string& name, GLint location);
+    GLuint createShader(const std::string& shaderCode, GLenum shaderType, GLuint program) const;
+    static bool CheckShader(GLuint shaderId);
+    static bool CheckProgram(GLuint program, GLenum status, const char* action);
+    static const char* StageName(GLenum shaderType);
     static std::string ReadFile(const std::string& path);
 };
@@ -0,0 +1,120 @@
+#include "shadercache.hpp"
+#include "opengl.hpp"
+
+bool ShaderCache::Enabled() {
+    if (directory.empty())
+        return false;
+
+    DriverKey(); // queries the accepted formats on first use
+    return !formats.empty();
+}
+
+uint64_t ShaderCache::Hash(std::string_view data, uint64_t hash) {
+    for (char c : data)
+        hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+    return hash;
+}
+
+uint64_t ShaderCache::DriverKey() {
+    if (driverKey)
+        return *driverKey;
+
+    uint64_t key = Offset;
+    for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+        auto value = reinterpret_cast<const char*>(glCall(glGetString, name));
+        key = Hash(value ? value : "", key);
+    }
+
+    GLint count = 0;
+    glCall(glGetIntegerv, GL_NUM_PROGRAM_BINARY_FORMATS, &count);
+    formats.resize(count);
+    if (count > 0)
+        glCall(glGetIntegerv, GL_PROGRAM_BINARY_FORMATS, formats.data());
+
+    driverKey = key;
+    return key;
+}
+
+bool ShaderCache::Load(GLuint program, uint64_t key) {
+    if (!Enabled())
+        return false;
+
+    std::ifstream in{ PathFor(key), std::ios::binary };
+    Header header{};
+    if (!in.is_open() || !in.read(reinterpret_cast<char*>(&header), sizeof(Header)) || header.magic != Magic || header.version != Version
+        || std::find(formats.begin(), formats.end(), static_cast<GLint>(header.format)) == formats.end()) {
+        misses++;
+        return false;
+    }
+
+    // A truncated or corrupt entry can claim more than the file holds, that is a miss rather than a huge allocation
+    auto start = in.tellg();
+    in.seekg(0, std::ios::end);
+    auto remaining = in.tellg() - start;
+    in.seekg(start);
+    if (!in || remaining < 0 || header.size > static_cast<uint64_t>(remaining)) {
+        misses++;
+        return false;
+    }
+
+    std::vector<char> binary(header.size);
+    if (!in.read(binary.data(), header.size)) {
+        misses++;
+        return false;
+    }
+
+    glCall(glProgramBinary, program, static_cast<GLenum>(header.format), binary.data(), static_cast<GLsizei>(binary.size()));
+
+    GLint status;
+    glCall(glGetProgramiv, program, GL_LINK_STATUS, &status);
+    if (!status) {
+        misses++;
+        return false;
+    }
+
+    hits++;
+    return true;
+}
+
+void ShaderCache::Store(GLuint program, uint64_t key) {
+    if (!Enabled())
+        return;
+
+    GLint status, length = 0;
+    glCall(glGetProgramiv, program, GL_LINK_STATUS, &status);
+    glCall(glGetProgramiv, program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (!status || length <= 0)
+        return;
+
+    std::vector<char> binary(length);
+    GLenum format;
+    glCall(glGetProgramBinary, program, length, &length, &format, binary.data());
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+
+    // Written next to the entry and renamed, an interrupted run never leaves a truncated binary behind
+    auto path = PathFor(key);
+    auto temporary = path;
+    temporary += ".tmp";
+
+    {
+        std::ofstream out{ temporary, std::ios::binary | std::ios::trunc };
+        Header header{ Magic, Version, format, static_cast<uint32_t>(length) };
+        if (!out.write(reinterpret_cast<const char*>(&header), sizeof(Header)) || !out.write(binary.data(), length)) {
+            std::cerr << "ERROR: Could not write shader cache entry: " << temporary.string() << std::endl;
+            return;
+        }
+    }
+
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::cerr << "ERROR: Could not write shader cache entry: " << path.string() << " (" << error.message() << ")" << std::endl;
+    }
+}
+
+std::filesystem::path ShaderCache::PathFor(uint64_t key) {
+    char name[24];
+    std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+    return directory / name;
+}
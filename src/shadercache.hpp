@@ -0,0 +1,40 @@
+#pragma once
+
+/// @brief On-disk cache of linked program binaries
+/// Entries are keyed by a hash of every stage source and the driver vendor/renderer/version strings, so a driver
+/// update or an edited shader simply misses. A rejected binary falls back to compiling from source, which then
+/// overwrites the entry. Caching is off when the directory is empty or the driver exposes no binary formats.
+class ShaderCache {
+public:
+    static void SetDirectory(const std::filesystem::path& path) { directory = path; }
+    static bool Enabled();
+
+    static uint64_t Hash(std::string_view data, uint64_t hash = Offset);
+    static uint64_t DriverKey();
+
+    static bool Load(GLuint program, uint64_t key);
+    static void Store(GLuint program, uint64_t key);
+
+    static uint32_t GetHits() { return hits; }
+    static uint32_t GetMisses() { return misses; }
+
+private:
+    static constexpr uint64_t Offset = 14695981039346656037ull;
+    static constexpr uint32_t Magic = 0x42504c47; // "GLPB"
+    static constexpr uint32_t Version = 1;
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t format;
+        uint32_t size;
+    };
+
+    static inline std::filesystem::path directory{ "cache/shaders" };
+    static inline std::vector<GLint> formats;
+    static inline std::optional<uint64_t> driverKey;
+    static inline uint32_t hits{ 0 };
+    static inline uint32_t misses{ 0 };
+
+    static std::filesystem::path PathFor(uint64_t key);
+};
@@ -0,0 +1,55 @@
+#include "shadervariants.hpp"
+#include "shader.hpp"
+
+ShaderVariants::ShaderVariants(std::string vertexPath, std::string fragmentPath, std::vector<std::string> features, Setup setup)
+    : vertexPath{std::move(vertexPath)}
+    , fragmentPath{std::move(fragmentPath)}
+    , features{std::move(features)}
+    , setup{std::move(setup)}
+    , variants(size_t{ 1 } << this->features.size())
+{
+}
+
+ShaderVariants::~ShaderVariants() = default;
+
+void ShaderVariants::beginFrame(Setup callback) {
+    frame = std::move(callback);
+    frameIndex++;
+}
+
+Shader& ShaderVariants::get(uint32_t mask) {
+    assert(mask < variants.size() && "Unknown shader feature");
+
+    auto& variant = variants[mask];
+    if (!variant.shader) {
+        variant.shader = std::make_unique<Shader>();
+        for (size_t i = 0; i < features.size(); i++) {
+            if (mask & (1u << i))
+                variant.shader->define(features[i]);
+        }
+
+        variant.shader->linkAsync(vertexPath, fragmentPath);
+        compiled++;
+    }
+
+    // Until it linked the caller skips the draw, afterwards a reload swaps in a program without our uniforms
+    auto& shader = *variant.shader;
+    if (!shader.isReady())
+        return shader;
+
+    if (variant.generation != shader.getGeneration()) {
+        shader.use();
+        if (setup)
+            setup(shader, mask);
+        variant.generation = shader.getGeneration();
+        variant.frame = 0;
+    }
+
+    if (frame && variant.frame != frameIndex) {
+        shader.use();
+        frame(shader, mask);
+        variant.frame = frameIndex;
+    }
+
+    return shader;
+}
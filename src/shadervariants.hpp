@@ -0,0 +1,49 @@
+#pragma once
+
+class Shader;
+
+/// @brief Feature bits of mainShader.frag, bit i turns on MainShaderDefines[i]
+enum MainShaderFeature : uint32_t {
+    FeatureTexture = 1 << 0,
+    FeatureLighting = 1 << 1,
+    FeatureFog = 1 << 2,
+    FeatureColouring = 1 << 3,
+    FeatureClustered = 1 << 4, // with LIGHTING, shade only the lights of the fragment's cluster
+    FeatureObjectLights = 1 << 5, // with LIGHTING, shade only the lights listed for the instance, takes precedence
+};
+
+inline const std::vector<std::string> MainShaderDefines{ "HAS_TEXTURE", "LIGHTING", "FOG", "COLOURING", "CLUSTERED", "OBJECT_LIGHTS" };
+
+/// @brief Programs built from one pair of sources with different combinations of feature defines
+/// Each combination is compiled (or loaded from the shader cache) the first time it is asked for and kept. The
+/// compile does not block, callers skip draws with a variant that is not ready yet. setup runs once on every newly
+/// linked program of a variant for its constant uniforms, the per-frame callback the first time a variant is used
+/// after beginFrame. Both run with the variant bound and get its mask to skip uniforms it compiled out.
+class ShaderVariants {
+public:
+    using Setup = std::function<void(Shader&, uint32_t features)>;
+
+    ShaderVariants(std::string vertexPath, std::string fragmentPath, std::vector<std::string> features, Setup setup = {});
+    ~ShaderVariants();
+
+    void beginFrame(Setup frame); // capture by value, it may run until the next beginFrame
+    Shader& get(uint32_t features);
+
+    uint32_t getCompiledCount() const { return compiled; }
+
+private:
+    struct Variant {
+        std::unique_ptr<Shader> shader;
+        uint32_t generation{ 0 };
+        uint64_t frame{ 0 };
+    };
+
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::vector<std::string> features;
+    Setup setup;
+    Setup frame;
+    uint64_t frameIndex{ 0 };
+    std::vector<Variant> variants; // indexed by the feature mask
+    uint32_t compiled{ 0 };
+};
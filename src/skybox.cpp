@@ -1,5 +1,6 @@
 #include "skybox.hpp"
 #include "opengl.hpp"
+#include "glstate.hpp"
 
 Skybox::Skybox(const std::array<std::string, 6>& faces) : cubemap{faces} {
     std::vector<glm::vec3> vertices {
@@ -54,9 +55,9 @@ Skybox::Skybox(const std::array<std::string, 6>& faces) : cubemap{faces} {
     glCall(glGenBuffers, 1, &vbo);
     glCall(glGenBuffers, 1, &ebo);
 
-    glCall(glBindVertexArray, vao);
+    GLState::BindVertexArray(vao);
 
-    glCall(glBindBuffer, GL_ARRAY_BUFFER, vbo);
+    GLState::BindBuffer(GL_ARRAY_BUFFER, vbo);
     glCall(glBufferData, GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec3), vertices.data(), GL_STATIC_DRAW);
 
     glCall(glBindBuffer, GL_ELEMENT_ARRAY_BUFFER, ebo);
@@ -65,11 +66,14 @@ Skybox::Skybox(const std::array<std::string, 6>& faces) : cubemap{faces} {
     glCall(glEnableVertexAttribArray, 0);
     glCall(glVertexAttribPointer, 0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (GLvoid*)0);
 
-    glCall(glBindBuffer, GL_ARRAY_BUFFER, 0);
-    glCall(glBindVertexArray, 0);
+    GLState::BindBuffer(GL_ARRAY_BUFFER, 0);
+    GLState::BindVertexArray(0);
 }
 
 Skybox::~Skybox() {
+    GLState::ForgetVertexArray(vao);
+    GLState::ForgetBuffer(vbo);
+    GLState::ForgetBuffer(ebo);
     glCall(glDeleteVertexArrays, 1, &vao);
     glCall(glDeleteBuffers, 1, &vbo);
     glCall(glDeleteBuffers, 1, &ebo);
@@ -77,8 +81,6 @@ Skybox::~Skybox() {
 
 void Skybox::render() {
     cubemap.bind();
-    glCall(glBindVertexArray, vao);
+    GLState::BindVertexArray(vao);
     glCall(glDrawElements, GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, (GLvoid*)0);
-    glCall(glBindVertexArray, 0);
-    cubemap.unbind();
 }
@@ -0,0 +1,96 @@
+#include "streambuffer.hpp"
+#include "opengl.hpp"
+#include "glstate.hpp"
+
+static constexpr GLsizeiptr RegionAlignment = 256;
+
+StreamBuffer::StreamBuffer(GLsizeiptr regionSize, uint32_t regionCount)
+    : regionSize{(regionSize + RegionAlignment - 1) / RegionAlignment * RegionAlignment}
+    , regionCount{regionCount}
+    , fences(regionCount, nullptr)
+{
+    GLint alignment;
+    glCall(glGetIntegerv, GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    uniformAlignment = alignment;
+    glCall(glGetIntegerv, GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    storageAlignment = alignment;
+
+    create();
+}
+
+StreamBuffer::~StreamBuffer() {
+    destroy();
+}
+
+void StreamBuffer::create() {
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    glCall(glGenBuffers, 1, &buffer);
+    GLState::BindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glCall(glBufferStorage, GL_COPY_WRITE_BUFFER, regionSize * regionCount, (GLvoid*) nullptr, flags);
+    mapped = static_cast<uint8_t*>(glCall(glMapBufferRange, GL_COPY_WRITE_BUFFER, 0, regionSize * regionCount, flags));
+    GLState::BindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    assert(mapped && "Failed to map stream buffer!");
+}
+
+void StreamBuffer::destroy() {
+    for (uint32_t i = 0; i < regionCount; i++) {
+        wait(i);
+    }
+
+    GLState::BindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glCall(glUnmapBuffer, GL_COPY_WRITE_BUFFER);
+    GLState::BindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    GLState::ForgetBuffer(buffer);
+    glCall(glDeleteBuffers, 1, &buffer);
+    mapped = nullptr;
+}
+
+void StreamBuffer::wait(uint32_t index) {
+    GLsync& fence = fences[index];
+    if (!fence)
+        return;
+
+    GLenum result;
+    do {
+        result = glCall(glClientWaitSync, fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); // 1ms
+    } while (result == GL_TIMEOUT_EXPIRED);
+
+    glCall(glDeleteSync, fence);
+    fence = nullptr;
+}
+
+void StreamBuffer::beginFrame() {
+    if (overflow > 0) {
+        // everything is idle after destroy(), so the ring can be recreated with room for the largest frame seen
+        destroy();
+        regionSize = std::max(regionSize * 2, (overflow + RegionAlignment - 1) / RegionAlignment * RegionAlignment);
+        overflow = 0;
+        create();
+        std::cout << "Stream buffer resized to " << regionSize * regionCount / 1024 << " kb" << std::endl;
+    }
+
+    region = (region + 1) % regionCount;
+    head = 0;
+    wait(region);
+}
+
+void StreamBuffer::endFrame() {
+    fences[region] = glCall(glFenceSync, GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+StreamBuffer::Allocation StreamBuffer::allocate(GLsizeiptr size, GLsizeiptr alignment) {
+    GLsizeiptr offset = (head + alignment - 1) / alignment * alignment;
+    if (offset + size > regionSize) {
+        if (overflow == 0)
+            std::cerr << "ERROR: Stream buffer region overflow, requested: " << size << " bytes" << std::endl;
+        overflow = std::max(overflow, offset + size);
+        return {};
+    }
+
+    head = offset + size;
+
+    GLintptr absolute = region * regionSize + offset;
+    return { mapped + absolute, buffer, absolute, size };
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+/// @brief Persistently mapped ring buffer for per-frame dynamic data
+/// The storage is split into regions (triple-buffered by default). Each frame writes into its own region,
+/// and a region is only reused once the fence placed after its frame has been signalled, so writes never
+/// wait on the driver. Allocations can be bound as UBO/SSBO ranges or vertex buffers.
+class StreamBuffer {
+public:
+    struct Allocation {
+        void* data{ nullptr };
+        GLuint buffer{ 0 };
+        GLintptr offset{ 0 };
+        GLsizeiptr size{ 0 };
+
+        explicit operator bool() const { return data != nullptr; }
+    };
+
+    StreamBuffer(GLsizeiptr regionSize, uint32_t regionCount = 3);
+    ~StreamBuffer();
+
+    void beginFrame();
+    void endFrame();
+
+    Allocation allocate(GLsizeiptr size, GLsizeiptr alignment = 16);
+
+    GLuint getId() const { return buffer; }
+    GLsizeiptr getUniformAlignment() const { return uniformAlignment; }
+    GLsizeiptr getStorageAlignment() const { return storageAlignment; }
+
+private:
+    GLuint buffer{ 0 };
+    uint8_t* mapped{ nullptr };
+    GLsizeiptr regionSize;
+    uint32_t regionCount;
+    uint32_t region{ 0 };
+    GLsizeiptr head{ 0 };
+    GLsizeiptr overflow{ 0 }; // largest request that did not fit, the buffer grows at the next frame
+    std::vector<GLsync> fences;
+
+    GLsizeiptr uniformAlignment{ 256 };
+    GLsizeiptr storageAlignment{ 256 };
+
+    void create();
+    void destroy();
+    void wait(uint32_t index);
+};
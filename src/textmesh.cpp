@@ -1,100 +1,73 @@
 #include "textmesh.hpp"
 #include "font.hpp"
+#include "streambuffer.hpp"
 #include "opengl.hpp"
+#include "glstate.hpp"
 
-TextMesh::TextMesh() {
+TextMesh::TextMesh(StreamBuffer& stream) : stream{stream} {
     glCall(glGenVertexArrays, 1, &vao);
-    glCall(glGenBuffers, 1, &vbo);
 
-    glCall(glBindVertexArray, vao);
-
-    glCall(glBindBuffer, GL_ARRAY_BUFFER, vbo);
-    glCall(glBufferData, GL_ARRAY_BUFFER, 6 * sizeof(glm::vec4), (GLvoid*) nullptr, GL_DYNAMIC_DRAW);
+    GLState::BindVertexArray(vao);
 
+    // The vertex buffer is a stream buffer range attached per string in render()
     glCall(glEnableVertexAttribArray, 0);
-    glCall(glVertexAttribPointer, 0, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (GLvoid*)0);
+    glCall(glVertexAttribFormat, 0, 4, GL_FLOAT, GL_FALSE, 0);
+    glCall(glVertexAttribBinding, 0, 0);
 
-    glCall(glBindBuffer, GL_ARRAY_BUFFER, 0);
-    glCall(glBindVertexArray, 0);
+    GLState::BindVertexArray(0);
 }
 
 TextMesh::~TextMesh() {
+    GLState::ForgetVertexArray(vao);
     glCall(glDeleteVertexArrays, 1, &vao);
-    glCall(glDeleteBuffers, 1, &vbo);
 }
 
-void TextMesh::render(const std::unique_ptr<Font>& font, const std::string& text, float x, float y, float scale) const {
-    glCall(glBindVertexArray, vao);
+void TextMesh::render(const Font& font, const std::string& text, float x, float y, float scale) const {
+    // All quads of the string are written straight into mapped memory and drawn at once
+    auto allocation = stream.allocate(static_cast<GLsizeiptr>(text.size() * 6 * sizeof(glm::vec4)), sizeof(glm::vec4));
+    if (!allocation)
+        return;
+
+    auto* quads = static_cast<glm::vec4*>(allocation.data);
+    GLsizei count = 0;
 
     float initial = x;
 
     for (const auto& c : text) {
         if (c == '\n') {
             x = initial;
-            y -= font->metrics;
+            y -= font.metrics;
             continue;
         }
 
-        const auto it = font->glyphs.find(c);
-        const auto& glyph = it != font->glyphs.end() ? it->second : font->glyphs.at(127);
+        const auto it = font.glyphs.find(c);
+        const auto& glyph = it != font.glyphs.end() ? it->second : font.glyphs.at(127);
 
         float px = x + glyph.bearing.x * scale;
         float py = y - (glyph.size.y - glyph.bearing.y) * scale;
-        float ox = glyph.size.x / font->width;
-        float oy = glyph.size.y / font->height;
+        float ox = glyph.size.x / font.width;
+        float oy = glyph.size.y / font.height;
         float tx = glyph.uv.x;
         float ty = glyph.uv.y;
 
         float w = glyph.size.x * scale;
         float h = glyph.size.y * scale;
 
-        float vertices[6][4] = {
-            {
-                px,
-                py + h,
-                tx,
-                ty
-            },
-            {
-                px,
-                py,
-                tx,
-                ty + oy
-            },
-            {
-                px + w,
-                py,
-                tx + ox,
-                ty + oy
-            },
-            {
-                px,
-                py + h,
-                tx,
-                ty
-            },
-            {
-                px + w,
-                py,
-                tx + ox,
-                ty + oy
-            },
-            {
-                px + w,
-                py + h,
-                tx + ox,
-                ty
-            }
-        };
-
-        glCall(glBindBuffer, GL_ARRAY_BUFFER, vbo);
-        glCall(glBufferSubData, GL_ARRAY_BUFFER, 0, 6 * sizeof(glm::vec4), &vertices);
-        glCall(glDrawArrays, GL_TRIANGLES, 0, 6);
+        quads[count++] = { px, py + h, tx, ty };
+        quads[count++] = { px, py, tx, ty + oy };
+        quads[count++] = { px + w, py, tx + ox, ty + oy };
+        quads[count++] = { px, py + h, tx, ty };
+        quads[count++] = { px + w, py, tx + ox, ty + oy };
+        quads[count++] = { px + w, py + h, tx + ox, ty };
 
         x += glyph.advance.x * scale;
     }
 
-    glCall(glBindBuffer, GL_ARRAY_BUFFER, 0);
-    glCall(glBindVertexArray, 0);
+    if (count == 0)
+        return;
+
+    GLState::BindVertexArray(vao);
+    glCall(glBindVertexBuffer, 0, allocation.buffer, allocation.offset, sizeof(glm::vec4));
+    glCall(glDrawArrays, GL_TRIANGLES, 0, count);
 }
 
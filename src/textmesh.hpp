@@ -1,14 +1,16 @@
 #pragma once
 
 class Font;
+class StreamBuffer;
 
 class TextMesh {
 public:
-    TextMesh();
+    TextMesh(StreamBuffer& stream);
     ~TextMesh();
 
-    void render(const std::unique_ptr<Font>& font, const std::string& text, float x, float y, float scale) const;
+    void render(const Font& font, const std::string& text, float x, float y, float scale) const;
 
 private:
-    GLuint vao, vbo;
+    GLuint vao;
+    StreamBuffer& stream;
 };
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "texture.hpp"
 #include "image.hpp"
 #include "opengl.hpp"
+#include "glstate.hpp"
 
 Texture::Texture(const std::string& path, bool linear, bool clamp, const glm::vec2& scale) : path{path}, scale{scale} {
     Image image{path};
@@ -17,7 +18,7 @@ Texture::Texture(const std::string& path, bool linear, bool clamp, const glm::ve
     }
 
     glCall(glGenTextures, 1, &textureId);
-    glCall(glBindTexture, GL_TEXTURE_2D, textureId);
+    GLState::BindTexture(0, GL_TEXTURE_2D, textureId);
     glCall(glTexImage2D, GL_TEXTURE_2D, 0, internalFormat, image.width, image.height, 0, dataFormat, GL_UNSIGNED_BYTE, image.pixels);
 
     if (linear) {
@@ -39,14 +40,14 @@ Texture::Texture(const std::string& path, bool linear, bool clamp, const glm::ve
     glCall(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 4);
     glCall(glGenerateMipmap, GL_TEXTURE_2D);
 
-    glCall(glBindTexture, GL_TEXTURE_2D, 0);
+    GLState::BindTexture(0, GL_TEXTURE_2D, 0);
 }
 
 Texture::Texture(uint8_t r, uint8_t g, uint8_t b) {
     uint8_t data[] = {r, g, b};
 
     glCall(glGenTextures, 1, &textureId);
-    glCall(glBindTexture, GL_TEXTURE_2D, textureId);
+    GLState::BindTexture(0, GL_TEXTURE_2D, textureId);
     glCall(glPixelStorei, GL_UNPACK_ALIGNMENT, 1);
 
     glCall(glTexImage2D, GL_TEXTURE_2D, 0, GL_RGB8, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
@@ -54,18 +55,14 @@ Texture::Texture(uint8_t r, uint8_t g, uint8_t b) {
     glCall(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glCall(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-    glCall(glBindTexture, GL_TEXTURE_2D, 0);
+    GLState::BindTexture(0, GL_TEXTURE_2D, 0);
 }
 
 Texture::~Texture() {
+    GLState::ForgetTexture(textureId);
     glCall(glDeleteTextures, 1, &textureId);
 }
 
 void Texture::bind(int i) const {
-    glCall(glActiveTexture, GL_TEXTURE0 + i);
-    glCall(glBindTexture, GL_TEXTURE_2D, textureId);
-}
-
-void Texture::unbind() const {
-    glCall(glBindTexture, GL_TEXTURE_2D, 0);
+    GLState::BindTexture(i, GL_TEXTURE_2D, textureId);
 }
\ No newline at end of file
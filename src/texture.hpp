@@ -7,7 +7,6 @@ public:
     ~Texture();
 
     void bind(int i) const;
-    void unbind() const;
 
     const std::string& getPath() const { return path; }
     const glm::vec2& getScale() const { return scale; }
@@ -8,3 +8,13 @@ struct Vertex {
     Vertex(const glm::vec3& position, const glm::vec3& normal, const glm::vec2& texture)
         : position{position}, normal{normal}, texture{texture} {}
 };
+
+/// Per-instance attributes consumed by mainShader.vert (locations 3-11)
+struct Instance {
+    glm::mat4 transform;
+    glm::mat3 normal;
+    float transparency;
+    glm::uvec2 lights{ 0 }; // first entry and count in the frame's object light list
+};
+
+static_assert(sizeof(Instance) == 28 * sizeof(uint32_t)); // INSTANCE_WORDS in cullShader.comp
@@ -15,6 +15,19 @@ Window::Window(std::string title, const glm::ivec2& size, const glm::ivec2& posi
     instances.push_back(window);
 }
 
+Window::Window(std::string title, const glm::ivec2& size, Backend backend)
+    : width{size.x}
+    , height{size.y}
+    , title{std::move(title)}
+    , position{0, 0}
+    , backend{backend}
+{
+    initGLFW();
+    initWindow(false);
+
+    instances.push_back(window);
+}
+
 Window::Window(std::string title)
     : width{1}
     , height{1}
@@ -44,6 +57,14 @@ void Window::initGLFW() {
     }
 
     if (instances.empty()) {
+        if (isHeadless()) {
+#ifdef GLFW_PLATFORM_NULL
+            glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#else
+            std::cerr << "ERROR: Headless mode needs GLFW 3.4, falling back to a hidden window" << std::endl;
+#endif
+        }
+
         int success = glfwInit();
         assert(success && "Failed to initialize GLFW!");
         glfwSetErrorCallback(ErrorCallback);
@@ -51,7 +72,16 @@ void Window::initGLFW() {
 }
 
 void Window::initWindow(bool fullscreen) {
-    std::cout << "Creating window: " << title << " [" << width << " " << height << "]" << std::endl;
+    std::cout << "Creating window: " << title << " [" << width << " " << height << "]" << (isHeadless() ? " headless" : "") << std::endl;
+
+#ifndef NDEBUG
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
+#endif
+
+    if (isHeadless()) {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, backend == Backend::Egl ? GLFW_EGL_CONTEXT_API : GLFW_OSMESA_CONTEXT_API);
+    }
 
     if (fullscreen) {
         auto monitor = glfwGetPrimaryMonitor();
@@ -70,7 +100,7 @@ void Window::initWindow(bool fullscreen) {
     int glad = gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress));
     assert(glad && "Failed to initialize GLAD!");
 
-    glfwSwapInterval(1); // enable vsync
+    glfwSwapInterval(isHeadless() ? 0 : 1); // enable vsync when there is a display to sync to
     glCall(glViewport, 0, 0, width, height);
 
     if (position != glm::ivec2{ 0, 0 }) {
@@ -91,7 +121,10 @@ void Window::FramebufferSizeCallback(GLFWwindow* handle, int width, int height)
     auto& window = *reinterpret_cast<Window *>(glfwGetWindowUserPointer(handle));
     window.width = width;
     window.height = height;
-    glCall(glViewport, 0, 0, width, height);
+
+    // Otherwise the render thread picks the size up with its next frame
+    if (glfwGetCurrentContext() == handle)
+        glCall(glViewport, 0, 0, width, height);
 }
 
 void Window::ErrorCallback(int error, const char* description) {
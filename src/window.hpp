@@ -4,7 +4,11 @@
 
 class Window {
 public:
+    // Headless backends create an invisible window on GLFW's null platform, so no display server is needed
+    enum class Backend { Native, Egl, OsMesa };
+
     Window(std::string title, const glm::ivec2& size, const glm::ivec2& position = {});
+    Window(std::string title, const glm::ivec2& size, Backend backend);
     Window(std::string title);
     ~Window();
 
@@ -21,6 +25,7 @@ public:
     void shouldClose(bool flag) const { glfwSetWindowShouldClose(window, flag); }
 
     void makeCurrent() const { glfwMakeContextCurrent(window); }
+    void releaseCurrent() const { glfwMakeContextCurrent(nullptr); }
     void swapBuffers() const { glfwSwapBuffers(window); }
 
     void showWindow(bool show = true) {
@@ -59,10 +64,10 @@ public:
         glfwSetInputMode(window, GLFW_CURSOR, locked ? GLFW_CURSOR_DISABLED : GLFW_CURSOR_NORMAL);
     }
 
-    void toggleWireframe() {
-        wireframe = !wireframe;
-        glCall(glPolygonMode, GL_FRONT_AND_BACK, wireframe ? GL_LINE : GL_FILL);
-    }
+    // The polygon mode is applied by the renderer, which may own the context on another thread
+    void toggleWireframe() { wireframe = !wireframe; }
+
+    bool isHeadless() const { return backend != Backend::Native; }
 
     bool Locked() const { return locked; }
     bool Wireframe() const { return wireframe; }
@@ -73,6 +78,7 @@ private:
     int height;
     std::string title;
     glm::ivec2 position;
+    Backend backend{ Backend::Native };
 
     bool locked{ false };
     bool wireframe{ false };